@@ -0,0 +1,323 @@
+#include "chebyshev.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <iostream>
+#include <limits>
+
+// In-place iterative radix-2 FFT; n must be a power of two.
+static void fft(vector<complex<double>> &a)
+{
+    const size_t n = a.size();
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            swap(a[i], a[j]);
+    }
+    for (size_t len = 2; len <= n; len *= 2) {
+        const double angle = -2 * M_PI / len;
+        for (size_t k = 0; k < len / 2; ++k) {
+            // Twiddles computed directly rather than by repeated
+            // multiplication, which would drift for large n.
+            const complex<double> w(cos(angle * k), sin(angle * k));
+            for (size_t i = k; i < n; i += len) {
+                const complex<double> u = a[i], v = a[i + len / 2] * w;
+                a[i] = u + v;
+                a[i + len / 2] = u - v;
+            }
+        }
+    }
+}
+
+// Chebyshev coefficients from values at t_j = cos(pi j / N), j = 0..N:
+// a DCT-I, as the FFT of the even extension of length 2N.
+static vector<double> chebyshevCoefficients(const vector<double> &v)
+{
+    const size_t N = v.size() - 1;
+    vector<complex<double>> w(2 * N);
+    for (size_t j = 0; j <= N; ++j)
+        w[j] = v[j];
+    for (size_t j = 1; j < N; ++j)
+        w[2 * N - j] = v[j];
+    fft(w);
+
+    vector<double> c(N + 1);
+    for (size_t k = 0; k <= N; ++k)
+        c[k] = w[k].real() / N;
+    c[0] /= 2;
+    c[N] /= 2;
+    return c;
+}
+
+// Coefficients of d/dx sum_k c_k T_k(t), with dt/dx = scale.
+static vector<double> derivativeCoefficients(const vector<double> &c, double scale)
+{
+    const size_t n = c.size() - 1;
+    if (n == 0)
+        return {0};
+    vector<double> d(n + 1, 0);
+    for (size_t k = n; k >= 1; --k)
+        d[k - 1] = (k + 1 <= n ? d[k + 1] : 0) + 2 * k * c[k];
+    d[0] /= 2;
+    d.resize(n);
+    for (double &v : d)
+        v *= scale;
+    return d;
+}
+
+static double clenshaw(const vector<double> &c, double t)
+{
+    double b1 = 0, b2 = 0;
+    for (size_t k = c.size(); k-- > 1;) {
+        const double b0 = c[k] + 2 * t * b1 - b2;
+        b2 = b1;
+        b1 = b0;
+    }
+    return c[0] + t * b1 - b2;
+}
+
+// Points per pool task when sampling f.
+static const size_t SampleBlock = 4096;
+
+// f at x[0..n-1]; parallel when f has a tape (GiNaC itself is not thread-safe).
+static void sample(const CompiledFunction &f, const double *x, double *out, size_t n)
+{
+    const size_t blocks = (n + SampleBlock - 1) / SampleBlock;
+    if (f.isCompiled() && blocks > 1) {
+        ThreadPool::instance().parallelFor(blocks, [&](size_t k) {
+            const size_t begin = k * SampleBlock;
+            f.evalBatch(x + begin, out + begin, min(n, begin + SampleBlock) - begin);
+        });
+    } else {
+        f.evalBatch(x, out, n);
+    }
+}
+
+ChebyshevProxy::ChebyshevProxy(const CompiledFunction &f, double a, double b, double tol, size_t maxDegree)
+{
+    if (!(a < b)) {
+        cerr << "A Chebyshev proxy needs a < b.\n";
+        return;
+    }
+    if (f.variables() != 1) {
+        cerr << "A Chebyshev proxy needs a function of one variable.\n";
+        return;
+    }
+    if (tol <= 0)
+        tol = 4 * numeric_limits<double>::epsilon();
+
+    const double mid = (a + b) / 2, half = (b - a) / 2;
+    // cos(pi j / N) as sin(pi (N - 2j) / 2N): exactly symmetric about mid.
+    auto node = [&](size_t j, size_t N) {
+        if (j == 0)
+            return b;
+        if (j == N)
+            return a;
+        return mid + half * sin(M_PI * (double(N) - 2.0 * j) / (2.0 * N));
+    };
+    auto finite = [](const vector<double> &v) {
+        return all_of(v.begin(), v.end(), [](double y) { return isfinite(y); });
+    };
+
+    size_t N = 16;
+    vector<double> X(N + 1), V(N + 1);
+    for (size_t j = 0; j <= N; ++j)
+        X[j] = node(j, N);
+    sample(f, X.data(), V.data(), X.size());
+    Evaluations = X.size();
+
+    vector<double> c;
+    double cutoff = 0, previousTail = INFINITY;
+    for (;;) {
+        if (!finite(V)) {
+            cerr << "f is not finite at a Chebyshev point of [" << a << ", " << b << "].\n";
+            return;
+        }
+        c = chebyshevCoefficients(V);
+
+        double vscale = 0, tail = 0;
+        for (double y : V)
+            vscale = max(vscale, fabs(y));
+        for (size_t k = N - N / 8; k <= N; ++k)
+            tail = max(tail, fabs(c[k]));
+
+        if (tail <= tol * vscale) {
+            cutoff = tol * vscale;
+            Converged = true;
+            break;
+        }
+        // Rounding in f itself: the tail is already tiny and has stopped
+        // falling, so more samples would only resolve noise.
+        if (tail <= 1e-8 * vscale && tail >= previousTail / 2) {
+            cutoff = 2 * tail;
+            Converged = true;
+            break;
+        }
+        if (2 * N > maxDegree)
+            break;
+        previousTail = tail;
+
+        // Double N; the old points are every other new one.
+        const size_t M = 2 * N;
+        vector<double> fresh(N), values(N);
+        for (size_t j = 0; j < N; ++j)
+            fresh[j] = node(2 * j + 1, M);
+        sample(f, fresh.data(), values.data(), N);
+        Evaluations += N;
+
+        vector<double> X2(M + 1), V2(M + 1);
+        for (size_t j = 0; j <= N; ++j) {
+            X2[2 * j] = X[j];
+            V2[2 * j] = V[j];
+        }
+        for (size_t j = 0; j < N; ++j) {
+            X2[2 * j + 1] = fresh[j];
+            V2[2 * j + 1] = values[j];
+        }
+        X.swap(X2);
+        V.swap(V2);
+        N = M;
+    }
+
+    // Chop after the last significant coefficient.
+    size_t last = 0;
+    for (size_t k = c.size(); k-- > 0;) {
+        if (fabs(c[k]) > cutoff) {
+            last = k;
+            break;
+        }
+    }
+    c.resize(last + 1);
+
+    A = a;
+    B = b;
+    C = move(c);
+    D = derivativeCoefficients(C, 2 / (b - a));
+    Nodes = move(X);
+    Values = move(V);
+
+    // Measure the error halfway (in angle) between the samples, where it
+    // peaks, on at most about 2048 points.
+    const size_t stride = max<size_t>(1, N / 2048);
+    vector<double> check, fx;
+    for (size_t j = 0; j < N; j += stride)
+        check.push_back(mid + half * cos(M_PI * (j + 0.5) / N));
+    fx.resize(check.size());
+    sample(f, check.data(), fx.data(), check.size());
+    Evaluations += check.size();
+
+    vector<double> px(check.size());
+    evalBatch(check.data(), px.data(), check.size());
+    MaxError = 0;
+    for (size_t i = 0; i < check.size(); ++i) {
+        const double e = fabs(fx[i] - px[i]);
+        if (isnan(e)) {
+            MaxError = NAN;
+            break;
+        }
+        MaxError = max(MaxError, e);
+    }
+}
+
+ChebyshevProxy::ChebyshevProxy(vector<double> coefficients, double a, double b)
+{
+    if (!(a < b) || coefficients.empty())
+        return;
+    A = a;
+    B = b;
+    C = move(coefficients);
+    D = derivativeCoefficients(C, 2 / (b - a));
+    Converged = true;
+}
+
+double ChebyshevProxy::operator()(double x) const
+{
+    if (!valid())
+        return NAN;
+    return clenshaw(C, toUnit(x));
+}
+
+Jet<1> ChebyshevProxy::jet(double x) const
+{
+    Jet<1> r;
+    if (!valid()) {
+        r.C[0] = r.C[1] = NAN;
+        return r;
+    }
+    const double t = toUnit(x);
+    r.C[0] = clenshaw(C, t);
+    r.C[1] = clenshaw(D, t);
+    return r;
+}
+
+// Queries per Clenshaw pass in evalBatch().
+static const size_t ClenshawBlock = 256;
+
+void ChebyshevProxy::evalBatch(const double *x, double *out, size_t n) const
+{
+    if (!valid()) {
+        fill(out, out + n, NAN);
+        return;
+    }
+    // The coefficient loop is outside the query loop, so each step is a
+    // plain vectorizable loop over the block.
+    double t[ClenshawBlock], b1[ClenshawBlock], b2[ClenshawBlock];
+    for (size_t begin = 0; begin < n; begin += ClenshawBlock) {
+        const size_t m = min(ClenshawBlock, n - begin);
+        for (size_t i = 0; i < m; ++i) {
+            t[i] = toUnit(x[begin + i]);
+            b1[i] = b2[i] = 0;
+        }
+        for (size_t k = C.size(); k-- > 1;) {
+            const double ck = C[k];
+            for (size_t i = 0; i < m; ++i) {
+                const double b0 = ck + 2 * t[i] * b1[i] - b2[i];
+                b2[i] = b1[i];
+                b1[i] = b0;
+            }
+        }
+        for (size_t i = 0; i < m; ++i)
+            out[begin + i] = C[0] + t[i] * b1[i] - b2[i];
+    }
+}
+
+ChebyshevProxy ChebyshevProxy::derivative() const
+{
+    if (!valid())
+        return {};
+    return ChebyshevProxy(D, A, B);
+}
+
+double ChebyshevProxy::integral() const
+{
+    if (!valid())
+        return NAN;
+    // int_{-1}^{1} T_k = 2 / (1 - k^2) for even k, 0 for odd k.
+    double sum = 0;
+    for (size_t k = 0; k < C.size(); k += 2)
+        sum += C[k] * 2 / (1 - double(k) * k);
+    return sum * (B - A) / 2;
+}
+
+ex ChebyshevProxy::polynomial(const symbol &sym) const
+{
+    if (!valid())
+        return 0;
+    const ex t = (2 * sym - A - B) / (B - A);
+    ex previous = 1, current = t;
+    ex p = C[0];
+    if (C.size() > 1)
+        p += C[1] * t;
+    for (size_t k = 2; k < C.size(); ++k) {
+        const ex next = expand(2 * t * current - previous);
+        p += C[k] * next;
+        previous = current;
+        current = next;
+    }
+    return p.expand();
+}
@@ -0,0 +1,98 @@
+#ifndef CHEBYSHEV_H
+#define CHEBYSHEV_H
+
+#include <cstddef>
+#include <ginac/ginac.h>
+#include <vector>
+
+#include "compiledfunction.h"
+#include "jet.h"
+
+using namespace std;
+using namespace GiNaC;
+
+/**
+ * Chebyshev proxy of f on [a, b]: p(x) = sum_k c_k T_k(t), with
+ * t = (2x - a - b) / (b - a) in [-1, 1].
+ *
+ * f is sampled at the Chebyshev–Lobatto points t_j = cos(pi j / N) for
+ * N = 16, 32, 64, ...; each doubling reuses every previous sample, and the
+ * coefficients come from a DCT-I of the samples computed by FFT, O(N log N).
+ * Sampling stops once the last eighth of the coefficients has decayed below
+ * tol * max|f| (or stopped decaying at a rounding plateau), and the series
+ * is chopped after its last significant coefficient, so the degree follows
+ * the smoothness of f rather than a guess.
+ *
+ * The achieved accuracy is then measured, not assumed: maxError() is the
+ * largest |f - p| over the midpoints between the final samples.
+ *
+ * Evaluation is Clenshaw's recurrence, O(degree) with no cos/acos. Outside
+ * [a, b] p is extrapolated and quickly loses accuracy.
+ */
+class ChebyshevProxy
+{
+public:
+    ChebyshevProxy() = default;
+
+    /**
+     * @param f          Single-variable function
+     * @param tol        Coefficient cutoff relative to max|f|; 0 for
+     *                   machine precision (4 eps)
+     * @param maxDegree  Largest N tried; beyond it converged() is false
+     *                   and the full series is kept
+     *
+     * When f is not finite at a sample, or a >= b, valid() is false (with
+     * a message on cerr) and every evaluation gives NaN.
+     */
+    ChebyshevProxy(const CompiledFunction &f, double a, double b, double tol = 0,
+                   size_t maxDegree = 1 << 16);
+
+    /** From known coefficients on [a, b]; maxError() is NaN (unknown). */
+    ChebyshevProxy(vector<double> coefficients, double a, double b);
+
+    bool valid() const { return !C.empty(); }
+    bool converged() const { return Converged; }
+    size_t degree() const { return C.empty() ? 0 : C.size() - 1; }
+    const vector<double> &coefficients() const { return C; }
+    double lower() const { return A; }
+    double upper() const { return B; }
+
+    /** max |f - p| over the check points (midpoints of the final grid). */
+    double maxError() const { return MaxError; }
+    /** Calls of f, sampling and checking together. */
+    long long evaluations() const { return Evaluations; }
+
+    /** The samples the coefficients came from, in decreasing x. */
+    const vector<double> &nodes() const { return Nodes; }
+    const vector<double> &values() const { return Values; }
+
+    double operator()(double x) const;
+
+    /** p and p' in one Clenshaw pass each, e.g. for Newton's method. */
+    Jet<1> jet(double x) const;
+
+    /** p at x[0..n-1], a block of queries per coefficient pass. */
+    void evalBatch(const double *x, double *out, size_t n) const;
+
+    /** p' as a proxy of degree - 1. */
+    ChebyshevProxy derivative() const;
+
+    /** Integral of p over [a, b] (Clenshaw–Curtis on the samples). */
+    double integral() const;
+
+    /** p(sym) expanded in powers of sym, built on request. Ill-conditioned past degree 30 or so. */
+    ex polynomial(const symbol &sym) const;
+
+private:
+    double toUnit(double x) const { return (2 * x - A - B) / (B - A); }
+
+    vector<double> C;  // c_0..c_degree
+    vector<double> D;  // coefficients of dp/dx, for jet()
+    vector<double> Nodes, Values;
+    double A = 0, B = 0;
+    double MaxError = NAN;
+    long long Evaluations = 0;
+    bool Converged = false;
+};
+
+#endif // CHEBYSHEV_H
@@ -0,0 +1,573 @@
+#include "compiledfunction.h"
+#include "simdmath.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+
+CompiledFunction::CompiledFunction(const ex &f_expr, const symbol &x)
+    : CompiledFunction(f_expr, vector<symbol>{x})
+{
+}
+
+CompiledFunction::CompiledFunction(const ex &f_expr, const vector<symbol> &vars)
+    : Expr(f_expr)
+    , Vars(vars)
+{
+    try {
+        emit(f_expr);
+        Compiled = true;
+    } catch (const exception &e) {
+        cerr << "Tape compilation failed, falling back to subs(): " << e.what() << endl;
+        Tape.clear();
+        Compiled = false;
+    }
+    Depth = 0;
+}
+
+void CompiledFunction::push(OpCode op, int arg, double value)
+{
+    switch (op) {
+    case PushConst:
+    case PushVar:
+        if (++Depth > MaxStack)
+            throw runtime_error("expression too deep for the evaluation stack");
+        Height = max(Height, Depth);
+        break;
+    case Add:
+    case Sub:
+    case Mul:
+    case Div:
+    case Pow:
+    case Atan2:
+        --Depth;
+        break;
+    default:
+        break;
+    }
+    Tape.push_back({op, arg, value});
+}
+
+// True for numbers and products with a negative numeric coefficient.
+static bool isNegative(const ex &e)
+{
+    if (is_a<numeric>(e))
+        return ex_to<numeric>(e).is_real() && ex_to<numeric>(e) < 0;
+    if (is_a<mul>(e)) {
+        const ex c = e.op(e.nops() - 1);
+        return is_a<numeric>(c) && ex_to<numeric>(c).is_real() && ex_to<numeric>(c) < 0;
+    }
+    return false;
+}
+
+// The value of an evaluated ex, or NaN when it is not a real number (a
+// leftover symbol, a complex result).
+static double realValue(const ex &e)
+{
+    if (!is_a<numeric>(e) || !ex_to<numeric>(e).is_real())
+        return NAN;
+    return ex_to<numeric>(e).to_double();
+}
+
+void CompiledFunction::emit(const ex &e)
+{
+    if (is_a<numeric>(e)) {
+        const numeric &n = ex_to<numeric>(e);
+        if (!n.is_real())
+            throw runtime_error("complex constant");
+        push(PushConst, 0, n.to_double());
+        return;
+    }
+
+    if (is_a<symbol>(e)) {
+        for (size_t i = 0; i < Vars.size(); ++i) {
+            if (e.is_equal(Vars[i])) {
+                push(PushVar, static_cast<int>(i));
+                return;
+            }
+        }
+        throw runtime_error("free symbol");
+    }
+
+    if (is_a<constant>(e)) {
+        push(PushConst, 0, ex_to<numeric>(e.evalf()).to_double());
+        return;
+    }
+
+    if (is_a<add>(e)) {
+        emit(e.op(0));
+        for (size_t i = 1; i < e.nops(); ++i) {
+            if (isNegative(e.op(i))) {
+                emit(-e.op(i));
+                push(Sub);
+            } else {
+                emit(e.op(i));
+                push(Add);
+            }
+        }
+        return;
+    }
+
+    if (is_a<mul>(e)) {
+        const ex c = e.op(e.nops() - 1);
+        if (is_a<numeric>(c) && ex_to<numeric>(c) == -1) {
+            emit(-e);
+            push(Neg);
+            return;
+        }
+
+        // Factors with a negative numeric exponent go to the denominator so
+        // x/y compiles to a single Div instead of Mul by pow(y, -1).
+        vector<ex> num, den;
+        for (size_t i = 0; i < e.nops(); ++i) {
+            const ex f = e.op(i);
+            if (is_a<power>(f) && isNegative(f.op(1)))
+                den.push_back(pow(f.op(0), -f.op(1)));
+            else
+                num.push_back(f);
+        }
+
+        if (num.empty())
+            push(PushConst, 0, 1.0);
+        for (size_t i = 0; i < num.size(); ++i) {
+            emit(num[i]);
+            if (i > 0)
+                push(Mul);
+        }
+        for (const ex &d : den) {
+            emit(d);
+            push(Div);
+        }
+        return;
+    }
+
+    if (is_a<power>(e)) {
+        const ex base = e.op(0), exponent = e.op(1);
+        if (is_a<numeric>(exponent) && ex_to<numeric>(exponent).is_real()) {
+            const numeric &p = ex_to<numeric>(exponent);
+            if (p.is_integer() && p.to_double() >= -64 && p.to_double() <= 64) {
+                emit(base);
+                push(PowInt, p.to_int());
+                return;
+            }
+            if (p.to_double() == 0.5) {
+                emit(base);
+                push(Sqrt);
+                return;
+            }
+        }
+        emit(base);
+        emit(exponent);
+        push(Pow);
+        return;
+    }
+
+    if (is_a<function>(e)) {
+        static const map<string, OpCode> unary = {
+            {"sqrt", Sqrt}, {"exp", Exp},   {"log", Log},     {"abs", Abs},
+            {"sin", Sin},   {"cos", Cos},   {"tan", Tan},     {"asin", Asin},
+            {"acos", Acos}, {"atan", Atan}, {"sinh", Sinh},   {"cosh", Cosh},
+            {"tanh", Tanh}, {"asinh", Asinh}, {"acosh", Acosh}, {"atanh", Atanh}};
+
+        const string name = ex_to<function>(e).get_name();
+        if (name == "atan2" && e.nops() == 2) {
+            emit(e.op(0));
+            emit(e.op(1));
+            push(Atan2);
+            return;
+        }
+
+        auto it = unary.find(name);
+        if (it == unary.end() || e.nops() != 1)
+            throw runtime_error("unsupported function " + name);
+        emit(e.op(0));
+        push(it->second);
+        return;
+    }
+
+    throw runtime_error("unsupported expression node");
+}
+
+static inline double powInt(double b, int n)
+{
+    bool invert = n < 0;
+    unsigned int k = invert ? -n : n;
+    double r = 1.0;
+    while (k) {
+        if (k & 1)
+            r *= b;
+        b *= b;
+        k >>= 1;
+    }
+    return invert ? 1.0 / r : r;
+}
+
+double CompiledFunction::operator()(double x) const
+{
+    return eval(&x);
+}
+
+double CompiledFunction::operator()(double x, double y) const
+{
+    const double vars[2] = {x, y};
+    return eval(vars);
+}
+
+double CompiledFunction::eval(const double *vars) const
+{
+    if (Native)
+        return Native(vars);
+    if (!Compiled)
+        return evalSymbolic(vars);
+    return evalTape(vars);
+}
+
+double CompiledFunction::evalTape(const double *vars) const
+{
+    double stack[MaxStack];
+    int top = -1;
+
+    for (const Instruction &in : Tape) {
+        switch (in.Op) {
+        case PushConst: stack[++top] = in.Value; break;
+        case PushVar:   stack[++top] = vars[in.Arg]; break;
+        case Add:   stack[top - 1] += stack[top]; --top; break;
+        case Sub:   stack[top - 1] -= stack[top]; --top; break;
+        case Mul:   stack[top - 1] *= stack[top]; --top; break;
+        case Div:   stack[top - 1] /= stack[top]; --top; break;
+        case Pow:   stack[top - 1] = std::pow(stack[top - 1], stack[top]); --top; break;
+        case Atan2: stack[top - 1] = std::atan2(stack[top - 1], stack[top]); --top; break;
+        case Neg:    stack[top] = -stack[top]; break;
+        case PowInt: stack[top] = powInt(stack[top], in.Arg); break;
+        case Sqrt:  stack[top] = std::sqrt(stack[top]); break;
+        case Exp:   stack[top] = std::exp(stack[top]); break;
+        case Log:   stack[top] = std::log(stack[top]); break;
+        case Abs:   stack[top] = std::fabs(stack[top]); break;
+        case Sin:   stack[top] = std::sin(stack[top]); break;
+        case Cos:   stack[top] = std::cos(stack[top]); break;
+        case Tan:   stack[top] = std::tan(stack[top]); break;
+        case Asin:  stack[top] = std::asin(stack[top]); break;
+        case Acos:  stack[top] = std::acos(stack[top]); break;
+        case Atan:  stack[top] = std::atan(stack[top]); break;
+        case Sinh:  stack[top] = std::sinh(stack[top]); break;
+        case Cosh:  stack[top] = std::cosh(stack[top]); break;
+        case Tanh:  stack[top] = std::tanh(stack[top]); break;
+        case Asinh: stack[top] = std::asinh(stack[top]); break;
+        case Acosh: stack[top] = std::acosh(stack[top]); break;
+        case Atanh: stack[top] = std::atanh(stack[top]); break;
+        }
+    }
+
+    return stack[0];
+}
+
+template <int N>
+Jet<N> CompiledFunction::jet(const double *vars, size_t wrt) const
+{
+    if (!Compiled)
+        return jetSymbolic<N>(vars, wrt);
+
+    Jet<N> stack[MaxStack];
+    int top = -1;
+
+    for (const Instruction &in : Tape) {
+        switch (in.Op) {
+        case PushConst: stack[++top] = Jet<N>::constant(in.Value); break;
+        case PushVar:
+            stack[++top] = size_t(in.Arg) == wrt ? Jet<N>::variable(vars[in.Arg])
+                                                 : Jet<N>::constant(vars[in.Arg]);
+            break;
+        case Add:   stack[top - 1] = stack[top - 1] + stack[top]; --top; break;
+        case Sub:   stack[top - 1] = stack[top - 1] - stack[top]; --top; break;
+        case Mul:   stack[top - 1] = stack[top - 1] * stack[top]; --top; break;
+        case Div:   stack[top - 1] = stack[top - 1] / stack[top]; --top; break;
+        case Pow:   stack[top - 1] = pow(stack[top - 1], stack[top]); --top; break;
+        case Atan2: stack[top - 1] = atan2(stack[top - 1], stack[top]); --top; break;
+        case Neg:    stack[top] = -stack[top]; break;
+        case PowInt: stack[top] = powInt(stack[top], in.Arg); break;
+        case Sqrt:  stack[top] = sqrt(stack[top]); break;
+        case Exp:   stack[top] = exp(stack[top]); break;
+        case Log:   stack[top] = log(stack[top]); break;
+        case Abs:   stack[top] = fabs(stack[top]); break;
+        case Sin:   stack[top] = sin(stack[top]); break;
+        case Cos:   stack[top] = cos(stack[top]); break;
+        case Tan:   stack[top] = tan(stack[top]); break;
+        case Asin:  stack[top] = asin(stack[top]); break;
+        case Acos:  stack[top] = acos(stack[top]); break;
+        case Atan:  stack[top] = atan(stack[top]); break;
+        case Sinh:  stack[top] = sinh(stack[top]); break;
+        case Cosh:  stack[top] = cosh(stack[top]); break;
+        case Tanh:  stack[top] = tanh(stack[top]); break;
+        case Asinh: stack[top] = asinh(stack[top]); break;
+        case Acosh: stack[top] = acosh(stack[top]); break;
+        case Atanh: stack[top] = atanh(stack[top]); break;
+        }
+    }
+
+    return stack[0];
+}
+
+// Fallback for expressions the tape rejected: differentiate symbolically.
+template <int N>
+Jet<N> CompiledFunction::jetSymbolic(const double *vars, size_t wrt) const
+{
+    lst values;
+    for (size_t i = 0; i < Vars.size(); ++i)
+        values.append(Vars[i] == vars[i]);
+
+    Jet<N> r;
+    ex d = Expr;
+    double factorial = 1;
+    for (int k = 0; k <= N; ++k) {
+        if (k > 0) {
+            d = d.diff(Vars[wrt]);
+            factorial *= k;
+        }
+        try {
+            r.C[k] = realValue(d.subs(values).evalf()) / factorial;
+        } catch (const exception &) {
+            r.C[k] = NAN;
+        }
+    }
+    return r;
+}
+
+template Jet<1> CompiledFunction::jet<1>(const double *, size_t) const;
+template Jet<2> CompiledFunction::jet<2>(const double *, size_t) const;
+template Jet<3> CompiledFunction::jet<3>(const double *, size_t) const;
+
+Interval CompiledFunction::evalInterval(const Interval *vars) const
+{
+    if (!Compiled)
+        return Interval::entire();
+
+    Interval stack[MaxStack];
+    int top = -1;
+
+    for (const Instruction &in : Tape) {
+        switch (in.Op) {
+        case PushConst: stack[++top] = Interval(in.Value); break;
+        case PushVar:   stack[++top] = vars[in.Arg]; break;
+        case Add:   stack[top - 1] = stack[top - 1] + stack[top]; --top; break;
+        case Sub:   stack[top - 1] = stack[top - 1] - stack[top]; --top; break;
+        case Mul:   stack[top - 1] = stack[top - 1] * stack[top]; --top; break;
+        case Div:   stack[top - 1] = stack[top - 1] / stack[top]; --top; break;
+        case Pow:   stack[top - 1] = pow(stack[top - 1], stack[top]); --top; break;
+        case Atan2: stack[top - 1] = atan2(stack[top - 1], stack[top]); --top; break;
+        case Neg:    stack[top] = -stack[top]; break;
+        case PowInt: stack[top] = powInt(stack[top], in.Arg); break;
+        case Sqrt:  stack[top] = sqrt(stack[top]); break;
+        case Exp:   stack[top] = exp(stack[top]); break;
+        case Log:   stack[top] = log(stack[top]); break;
+        case Abs:   stack[top] = fabs(stack[top]); break;
+        case Sin:   stack[top] = sin(stack[top]); break;
+        case Cos:   stack[top] = cos(stack[top]); break;
+        case Tan:   stack[top] = tan(stack[top]); break;
+        case Asin:  stack[top] = asin(stack[top]); break;
+        case Acos:  stack[top] = acos(stack[top]); break;
+        case Atan:  stack[top] = atan(stack[top]); break;
+        case Sinh:  stack[top] = sinh(stack[top]); break;
+        case Cosh:  stack[top] = cosh(stack[top]); break;
+        case Tanh:  stack[top] = tanh(stack[top]); break;
+        case Asinh: stack[top] = asinh(stack[top]); break;
+        case Acosh: stack[top] = acosh(stack[top]); break;
+        case Atanh: stack[top] = atanh(stack[top]); break;
+        }
+    }
+
+    return stack[0];
+}
+
+CompiledFunction CompiledFunction::derivative(size_t wrt) const
+{
+    return CompiledFunction(Expr.diff(Vars[wrt]), Vars);
+}
+
+void CompiledFunction::evalBatch(const double *x, double *out, size_t n) const
+{
+    const double *columns[1] = {x};
+    evalBatch(columns, out, n);
+}
+
+void CompiledFunction::evalBatch(const double *const *columns, double *out, size_t n) const
+{
+    if (Native || !Compiled) {
+        vector<double> vars(Vars.size());
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t v = 0; v < Vars.size(); ++v)
+                vars[v] = columns[v][i];
+            out[i] = eval(vars.data());
+        }
+        return;
+    }
+
+    // One extra register is scratch space for PowInt.
+    vector<double> stack((Height + 1) * Block);
+    for (size_t i0 = 0; i0 < n; i0 += Block) {
+        const size_t m = min(Block, n - i0);
+        evalTapeBlock(columns, i0, m, stack.data());
+        copy(stack.begin(), stack.begin() + m, out + i0);
+    }
+}
+
+// Same instruction semantics as evalTape(), but every stack slot is a
+// register of m lanes and each instruction is a loop over them.
+void CompiledFunction::evalTapeBlock(const double *const *columns, size_t offset, size_t m, double *stack) const
+{
+    auto reg = [&](int i) { return stack + i * Block; };
+    int top = -1;
+
+    auto unary = [&](auto fn) {
+        double *a = reg(top);
+        for (size_t i = 0; i < m; ++i)
+            a[i] = fn(a[i]);
+    };
+    auto binary = [&](auto fn) {
+        double *a = reg(top - 1), *b = reg(top);
+        for (size_t i = 0; i < m; ++i)
+            a[i] = fn(a[i], b[i]);
+        --top;
+    };
+
+    for (const Instruction &in : Tape) {
+        switch (in.Op) {
+        case PushConst: ++top; fill(reg(top), reg(top) + m, in.Value); break;
+        case PushVar:   ++top; copy(columns[in.Arg] + offset, columns[in.Arg] + offset + m, reg(top)); break;
+        case Add:   binary([](double a, double b) { return a + b; }); break;
+        case Sub:   binary([](double a, double b) { return a - b; }); break;
+        case Mul:   binary([](double a, double b) { return a * b; }); break;
+        case Div:   binary([](double a, double b) { return a / b; }); break;
+        case Pow:   simdPow(reg(top - 1), reg(top), reg(top - 1), m); --top; break;
+        case Atan2: binary([](double a, double b) { return std::atan2(a, b); }); break;
+        case Neg:   unary([](double a) { return -a; }); break;
+        case PowInt: {
+            // Binary exponentiation with the bit loop outside the lane loop.
+            double *b = reg(top), *r = reg(Height);
+            unsigned int k = in.Arg < 0 ? -in.Arg : in.Arg;
+            fill(r, r + m, 1.0);
+            while (k) {
+                if (k & 1) {
+                    for (size_t i = 0; i < m; ++i)
+                        r[i] *= b[i];
+                }
+                k >>= 1;
+                if (k) {
+                    for (size_t i = 0; i < m; ++i)
+                        b[i] *= b[i];
+                }
+            }
+            for (size_t i = 0; i < m; ++i)
+                b[i] = in.Arg < 0 ? 1.0 / r[i] : r[i];
+            break;
+        }
+        case Sqrt:  simdSqrt(reg(top), reg(top), m); break;
+        case Exp:   simdExp(reg(top), reg(top), m); break;
+        case Log:   simdLog(reg(top), reg(top), m); break;
+        case Abs:   unary([](double a) { return std::fabs(a); }); break;
+        case Sin:   simdSin(reg(top), reg(top), m); break;
+        case Cos:   simdCos(reg(top), reg(top), m); break;
+        case Tan:   unary([](double a) { return std::tan(a); }); break;
+        case Asin:  unary([](double a) { return std::asin(a); }); break;
+        case Acos:  unary([](double a) { return std::acos(a); }); break;
+        case Atan:  unary([](double a) { return std::atan(a); }); break;
+        case Sinh:  unary([](double a) { return std::sinh(a); }); break;
+        case Cosh:  unary([](double a) { return std::cosh(a); }); break;
+        case Tanh:  unary([](double a) { return std::tanh(a); }); break;
+        case Asinh: unary([](double a) { return std::asinh(a); }); break;
+        case Acosh: unary([](double a) { return std::acosh(a); }); break;
+        case Atanh: unary([](double a) { return std::atanh(a); }); break;
+        }
+    }
+}
+
+double CompiledFunction::evalSymbolic(const double *vars) const
+{
+    lst values;
+    for (size_t i = 0; i < Vars.size(); ++i)
+        values.append(Vars[i] == vars[i]);
+
+    try {
+        return realValue(Expr.subs(values).evalf());
+    } catch (const exception &) {
+        return NAN;
+    }
+}
+
+NativeReport CompiledFunction::enableNative()
+{
+    using clock = chrono::steady_clock;
+    NativeReport report;
+    Native = NativeFunction::load(Expr, Vars, report);
+    if (!Native)
+        return report;
+
+    // Mean latency over a sweep of [0, 1) in every variable.
+    const int calls = 100000;
+    vector<double> vars(Vars.size());
+    volatile double sink = 0;
+
+    auto t0 = clock::now();
+    for (int i = 0; i < calls; ++i) {
+        fill(vars.begin(), vars.end(), i * (1.0 / calls));
+        sink = Native(vars.data());
+    }
+    report.NativeCallNs = chrono::duration<double, nano>(clock::now() - t0).count() / calls;
+
+    t0 = clock::now();
+    for (int i = 0; i < calls; ++i) {
+        fill(vars.begin(), vars.end(), i * (1.0 / calls));
+        sink = Compiled ? evalTape(vars.data()) : evalSymbolic(vars.data());
+    }
+    report.TapeCallNs = chrono::duration<double, nano>(clock::now() - t0).count() / calls;
+    (void) sink;
+
+    return report;
+}
+
+EvaluationBenchmark CompiledFunction::benchmark(const ex &f_expr, const symbol &x, double a, double b, int samples)
+{
+    using clock = chrono::steady_clock;
+    EvaluationBenchmark Result{0, 0, 0};
+    if (samples < 2)
+        return Result;
+
+    const double h = (b - a) / (samples - 1);
+    volatile double sink = 0;
+
+    auto t0 = clock::now();
+    for (int i = 0; i < samples; ++i) {
+        try {
+            sink = realValue(f_expr.subs(x == a + i * h).evalf());
+        } catch (const exception &) {
+        }
+    }
+    double symbolic = chrono::duration<double>(clock::now() - t0).count();
+
+    // The tape is cheap enough that a single pass is below timer resolution.
+    CompiledFunction f(f_expr, x);
+    const int repeats = 100;
+    t0 = clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        for (int i = 0; i < samples; ++i)
+            sink = f(a + i * h);
+    }
+    double compiled = chrono::duration<double>(clock::now() - t0).count();
+
+    vector<double> xs(samples), ys(samples);
+    for (int i = 0; i < samples; ++i)
+        xs[i] = a + i * h;
+    t0 = clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        f.evalBatch(xs.data(), ys.data(), samples);
+        sink = ys[r % samples];
+    }
+    double batch = chrono::duration<double>(clock::now() - t0).count();
+    (void) sink;
+
+    Result.SymbolicPerSecond = symbolic > 0 ? samples / symbolic : 0;
+    Result.CompiledPerSecond = compiled > 0 ? (double(samples) * repeats) / compiled : 0;
+    Result.BatchPerSecond = batch > 0 ? (double(samples) * repeats) / batch : 0;
+    return Result;
+}
@@ -0,0 +1,154 @@
+#ifndef COMPILEDFUNCTION_H
+#define COMPILEDFUNCTION_H
+
+#include <ginac/ginac.h>
+#include <vector>
+
+#include "interval.h"
+#include "jet.h"
+#include "nativefunction.h"
+
+using namespace std;
+using namespace GiNaC;
+
+struct EvaluationBenchmark
+{
+    double SymbolicPerSecond; // ex.subs() + to_double()
+    double CompiledPerSecond; // flat tape
+    double BatchPerSecond;    // evalBatch() over all samples at once
+};
+
+/**
+ * A GiNaC expression flattened into a postfix tape over double registers.
+ *
+ * The expression tree is walked once at construction; evaluation then runs a
+ * tight switch loop over a fixed-size stack, with no symbolic work and no heap
+ * allocation per call. Expressions the tape cannot represent (complex
+ * constants, unknown functions, free symbols) fall back to subs().
+ *
+ * enableNative() optionally swaps the tape for a kernel built by the system C
+ * compiler (see NativeFunction); the tape stays as the fallback.
+ */
+class CompiledFunction
+{
+public:
+    CompiledFunction() = default;
+
+    /**
+     * @param f_expr  Symbolic expression (e.g. from RootMethods::make_full_parser)
+     * @param x       Single variable of f
+     */
+    CompiledFunction(const ex &f_expr, const symbol &x);
+
+    /**
+     * @param f_expr  Symbolic expression
+     * @param vars    Variables of f, in the order eval() expects them
+     */
+    CompiledFunction(const ex &f_expr, const vector<symbol> &vars);
+
+    double operator()(double x) const;
+    double operator()(double x, double y) const;
+
+    /**
+     * Evaluate f at vars[0..variables()-1].
+     * Domain errors produce NaN/inf rather than exceptions.
+     */
+    double eval(const double *vars) const;
+
+    /**
+     * Forward-mode derivatives: run the tape on truncated Taylor series, so
+     * one pass yields f and its first N derivatives with respect to vars[wrt]
+     * (jet<1> = value + f', jet<2> adds f'' for Halley-type steps).
+     * Instantiated for N = 1, 2, 3.
+     */
+    template <int N>
+    Jet<N> jet(const double *vars, size_t wrt = 0) const;
+
+    template <int N>
+    Jet<N> jet(double x) const { return jet<N>(&x); }
+
+    /**
+     * Interval extension of f: every f(v) with v[i] in vars[i] lies inside
+     * the result (see interval.h). An empty result means f is undefined on
+     * the whole box. Without a tape the result is the entire real line.
+     */
+    Interval evalInterval(const Interval *vars) const;
+    Interval evalInterval(const Interval &x) const { return evalInterval(&x); }
+
+    /**
+     * df/dvars[wrt], differentiated symbolically once and compiled.
+     */
+    CompiledFunction derivative(size_t wrt = 0) const;
+
+    /**
+     * Evaluate a single-variable f at x[0..n-1] into out[0..n-1].
+     *
+     * The tape runs block by block over arrays instead of scalars, so the
+     * arithmetic vectorizes and exp/log/sin/cos/pow/sqrt go through the SIMD
+     * kernels in simdmath.h. Results agree with eval() to the ULP bounds
+     * documented there. x and out may alias.
+     */
+    void evalBatch(const double *x, double *out, size_t n) const;
+
+    /**
+     * Multi-variable form: columns[v][i] is variable v at point i.
+     */
+    void evalBatch(const double *const *columns, double *out, size_t n) const;
+
+    /**
+     * Opt-in native mode: compile f with the system C compiler and route
+     * eval() through the loaded kernel. Falls back silently to the tape.
+     *
+     * @return  Load status, compile time and per-call latency of both paths
+     */
+    NativeReport enableNative();
+
+    bool isCompiled() const { return Compiled; }
+    bool isNative() const { return Native != nullptr; }
+    size_t variables() const { return Vars.size(); }
+    size_t tapeSize() const { return Tape.size(); }
+
+    /**
+     * Time symbolic substitution against the tape on `samples` equally
+     * spaced points of [a, b].
+     */
+    static EvaluationBenchmark benchmark(const ex &f_expr, const symbol &x, double a, double b, int samples = 2000);
+
+private:
+    enum OpCode : unsigned char {
+        PushConst, PushVar,
+        Add, Sub, Mul, Div, Neg, Pow, PowInt,
+        Sqrt, Exp, Log, Abs,
+        Sin, Cos, Tan, Asin, Acos, Atan, Atan2,
+        Sinh, Cosh, Tanh, Asinh, Acosh, Atanh
+    };
+
+    struct Instruction
+    {
+        OpCode Op;
+        int Arg;      // variable index / integer exponent
+        double Value; // constant
+    };
+
+    static const int MaxStack = 64;
+    static constexpr size_t Block = 256; // lanes per evalBatch() register
+
+    void emit(const ex &e);
+    void push(OpCode op, int arg = 0, double value = 0);
+    double evalSymbolic(const double *vars) const;
+    double evalTape(const double *vars) const;
+    template <int N>
+    Jet<N> jetSymbolic(const double *vars, size_t wrt) const;
+    void evalTapeBlock(const double *const *columns, size_t offset, size_t m, double *stack) const;
+
+    vector<Instruction> Tape;
+    int Depth = 0;
+    int Height = 0; // deepest stack use, sizes the evalBatch() registers
+
+    ex Expr;
+    vector<symbol> Vars;
+    bool Compiled = false;
+    NativeFunction::Kernel Native = nullptr;
+};
+
+#endif // COMPILEDFUNCTION_H
@@ -0,0 +1,206 @@
+#include "cubicspline.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+CubicSpline::CubicSpline(const vector<double> &x, const vector<double> &y, SplineBoundary boundary,
+                         double startSlope, double endSlope)
+    : CubicSpline(x.data(), y.data(), min(x.size(), y.size()), boundary, startSlope, endSlope)
+{
+}
+
+CubicSpline::CubicSpline(const double *x, const double *y, size_t n, SplineBoundary boundary,
+                         double startSlope, double endSlope)
+{
+    if (n < 2) {
+        cerr << "A cubic spline needs at least two knots.\n";
+        return;
+    }
+    for (size_t i = 0; i + 1 < n; ++i) {
+        if (!(x[i + 1] > x[i])) {
+            cerr << "Spline knots must be strictly increasing.\n";
+            return;
+        }
+    }
+
+    // Second derivatives M_i solve, for the interior knots,
+    //   h_{i-1} M_{i-1} + 2 (h_{i-1} + h_i) M_i + h_i M_{i+1} = 6 (s_i - s_{i-1})
+    // with h_i = x_{i+1} - x_i and slopes s_i = (y_{i+1} - y_i) / h_i.
+    // Rows 0 and n-1 come from the boundary. sub/diag/sup/rhs hold the
+    // tridiagonal system; M overwrites rhs.
+    vector<double> sub(n, 0), diag(n, 1), sup(n, 0), M(n, 0);
+    auto h = [&](size_t i) { return x[i + 1] - x[i]; };
+    auto s = [&](size_t i) { return (y[i + 1] - y[i]) / h(i); };
+
+    for (size_t i = 1; i + 1 < n; ++i) {
+        sub[i] = h(i - 1);
+        diag[i] = 2 * (h(i - 1) + h(i));
+        sup[i] = h(i);
+        M[i] = 6 * (s(i) - s(i - 1));
+    }
+
+    size_t first = 0, last = n - 1; // rows actually solved
+    if (boundary == SplineBoundary::Clamped) {
+        diag[0] = 2 * h(0);
+        sup[0] = h(0);
+        M[0] = 6 * (s(0) - startSlope);
+        sub[n - 1] = h(n - 2);
+        diag[n - 1] = 2 * h(n - 2);
+        M[n - 1] = 6 * (endSlope - s(n - 2));
+    } else if (boundary == SplineBoundary::NotAKnot && n >= 4) {
+        // M_0 = ((h0 + h1) M_1 - h0 M_2) / h1 folded into row 1, and the
+        // mirror image into row n-2; rows 0 and n-1 are recovered after.
+        const double h0 = h(0), h1 = h(1);
+        diag[1] += h0 * (h0 + h1) / h1;
+        sup[1] -= h0 * h0 / h1;
+        const double hl = h(n - 2), hk = h(n - 3);
+        diag[n - 2] += hl * (hl + hk) / hk;
+        sub[n - 2] -= hl * hl / hk;
+        first = 1;
+        last = n - 2;
+    } else if (boundary == SplineBoundary::NotAKnot) {
+        // Two or three knots: the line or parabola through them.
+        const double m = n == 3 ? 2 * (s(1) - s(0)) / (x[2] - x[0]) : 0;
+        fill(M.begin(), M.end(), m);
+        first = 1;
+        last = 0; // nothing to solve
+    }
+    // Natural: rows 0 and n-1 are M = 0 as initialized.
+
+    // Thomas algorithm on rows first..last
+    if (first <= last) {
+        for (size_t i = first + 1; i <= last; ++i) {
+            const double w = sub[i] / diag[i - 1];
+            diag[i] -= w * sup[i - 1];
+            M[i] -= w * M[i - 1];
+        }
+        M[last] /= diag[last];
+        for (size_t i = last; i-- > first;)
+            M[i] = (M[i] - sup[i] * M[i + 1]) / diag[i];
+    }
+    if (boundary == SplineBoundary::NotAKnot && n >= 4) {
+        M[0] = ((h(0) + h(1)) * M[1] - h(0) * M[2]) / h(1);
+        M[n - 1] = ((h(n - 2) + h(n - 3)) * M[n - 2] - h(n - 2) * M[n - 3]) / h(n - 3);
+    }
+
+    X.assign(x, x + n);
+    Coeffs.resize(4 * (n - 1));
+    for (size_t i = 0; i + 1 < n; ++i) {
+        double *c = &Coeffs[4 * i];
+        c[0] = y[i];
+        c[1] = s(i) - h(i) * (2 * M[i] + M[i + 1]) / 6;
+        c[2] = M[i] / 2;
+        c[3] = (M[i + 1] - M[i]) / (6 * h(i));
+    }
+
+    // Equal spacing (to rounding) allows the piece to be computed directly.
+    const double spacing = (X.back() - X.front()) / (n - 1);
+    const double tolerance = 8 * numeric_limits<double>::epsilon() * max(fabs(X.front()), fabs(X.back()));
+    Uniform = true;
+    for (size_t i = 0; i < n && Uniform; ++i)
+        Uniform = fabs(X[i] - (X.front() + i * spacing)) <= tolerance;
+    InvH = 1 / spacing;
+}
+
+size_t CubicSpline::locate(double t) const
+{
+    const size_t pieces = X.size() - 1;
+    if (Uniform) {
+        const double k = floor((t - X.front()) * InvH);
+        // !(k > 0) also catches NaN, whose size_t conversion is undefined;
+        // the piece then just evaluates to NaN.
+        size_t i = !(k > 0) ? 0 : k >= pieces - 1 ? pieces - 1 : size_t(k);
+        // The division can land one piece off next to a knot.
+        if (i > 0 && t < X[i])
+            --i;
+        else if (i + 1 < pieces && t >= X[i + 1])
+            ++i;
+        return i;
+    }
+    // Last knot <= t among x_1..x_{n-2}
+    const size_t i = upper_bound(X.begin() + 1, X.end() - 1, t) - X.begin();
+    return i - 1;
+}
+
+size_t CubicSpline::advance(size_t i, double t) const
+{
+    const size_t pieces = X.size() - 1;
+    if (t < X[i])
+        return locate(t);
+    // Gallop: 1, 2, 4, ... pieces ahead until past t, then bisect.
+    size_t step = 1, lo = i;
+    while (lo + step < pieces && X[lo + step] <= t) {
+        lo += step;
+        step *= 2;
+    }
+    size_t hi = min(lo + step, pieces); // X[hi] > t or hi = pieces
+    while (hi - lo > 1) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (X[mid] <= t)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+double CubicSpline::operator()(double t) const
+{
+    if (!valid())
+        return NAN;
+    return evalPiece(locate(t), t);
+}
+
+// Queries per pool task.
+static const size_t SplineChunk = 65536;
+
+void CubicSpline::evalBatch(const double *t, double *out, size_t n) const
+{
+    if (!valid()) {
+        fill(out, out + n, NAN);
+        return;
+    }
+    const size_t chunks = (n + SplineChunk - 1) / SplineChunk;
+    auto body = [&](size_t c) {
+        const size_t end = min(n, (c + 1) * SplineChunk);
+        for (size_t i = c * SplineChunk; i < end; ++i)
+            out[i] = evalPiece(locate(t[i]), t[i]);
+    };
+    if (chunks > 1)
+        ThreadPool::instance().parallelFor(chunks, body);
+    else if (chunks == 1)
+        body(0);
+}
+
+void CubicSpline::evalSorted(const double *t, double *out, size_t n) const
+{
+    if (!valid()) {
+        fill(out, out + n, NAN);
+        return;
+    }
+    // Each chunk starts with a search, then walks.
+    const size_t chunks = (n + SplineChunk - 1) / SplineChunk;
+    auto body = [&](size_t c) {
+        const size_t begin = c * SplineChunk, end = min(n, begin + SplineChunk);
+        size_t piece = locate(t[begin]);
+        for (size_t i = begin; i < end; ++i) {
+            if (!(t[i] < X[piece + 1]) || t[i] < X[piece])
+                piece = advance(piece, t[i]);
+            out[i] = evalPiece(piece, t[i]);
+        }
+    };
+    if (chunks > 1)
+        ThreadPool::instance().parallelFor(chunks, body);
+    else if (chunks == 1)
+        body(0);
+}
+
+ex CubicSpline::piecePolynomial(size_t i, const symbol &sym) const
+{
+    const double *c = piece(i);
+    const ex u = sym - X[i];
+    return c[0] + c[1] * u + c[2] * pow(u, 2) + c[3] * pow(u, 3);
+}
@@ -0,0 +1,92 @@
+#ifndef CUBICSPLINE_H
+#define CUBICSPLINE_H
+
+#include <cstddef>
+#include <ginac/ginac.h>
+#include <vector>
+
+using namespace std;
+using namespace GiNaC;
+
+/** End conditions of a cubic spline. */
+enum class SplineBoundary
+{
+    Natural,   // S'' = 0 at both ends
+    Clamped,   // S' given at both ends
+    NotAKnot   // S''' continuous at x_1 and x_{n-2}: first two and last two pieces are one cubic
+};
+
+/**
+ * Interpolating cubic spline on strictly increasing knots.
+ *
+ * Built in O(n): one tridiagonal solve (Thomas algorithm) for the second
+ * derivatives, then the coefficients of every piece, stored interleaved as
+ * a, b, c, d in one contiguous array so a lookup touches one cache line:
+ * S(t) = a + b u + c u^2 + d u^3 with u = t - x_i on [x_i, x_{i+1}].
+ *
+ * A query finds its piece by binary search, or by one division when the
+ * knots are equally spaced. Sorted query batches walk the knots instead,
+ * galloping ahead, and large batches are split across the thread pool.
+ * Outside [x_0, x_{n-1}] the end pieces are extended.
+ */
+class CubicSpline
+{
+public:
+    CubicSpline() = default;
+
+    /**
+     * @param x, y                 n >= 2 knots, x strictly increasing
+     * @param startSlope, endSlope S'(x_0) and S'(x_{n-1}), Clamped only
+     *
+     * On bad input valid() is false (with a message on cerr) and every
+     * evaluation gives NaN.
+     */
+    CubicSpline(const double *x, const double *y, size_t n, SplineBoundary boundary,
+                double startSlope = 0, double endSlope = 0);
+    CubicSpline(const vector<double> &x, const vector<double> &y, SplineBoundary boundary,
+                double startSlope = 0, double endSlope = 0);
+
+    bool valid() const { return !X.empty(); }
+    size_t knots() const { return X.size(); }
+    bool uniform() const { return Uniform; }
+    const vector<double> &nodes() const { return X; }
+
+    /** Coefficients a, b, c, d of piece i (on [x_i, x_{i+1}]). */
+    const double *piece(size_t i) const { return &Coeffs[4 * i]; }
+
+    /** Index of the piece used for t, in [0, knots() - 2]. */
+    size_t locate(double t) const;
+
+    double operator()(double t) const;
+
+    /** S at t[0..n-1], in any order; parallel for large n. */
+    void evalBatch(const double *t, double *out, size_t n) const;
+
+    /**
+     * S at nondecreasing t[0..n-1]: O(n + knots) instead of O(n log knots).
+     * A query smaller than its predecessor is still answered correctly,
+     * by a fresh search.
+     */
+    void evalSorted(const double *t, double *out, size_t n) const;
+
+    /** Piece i as an ex in sym, for display. */
+    ex piecePolynomial(size_t i, const symbol &sym) const;
+
+private:
+    double evalPiece(size_t i, double t) const
+    {
+        const double *c = &Coeffs[4 * i];
+        const double u = t - X[i];
+        return c[0] + u * (c[1] + u * (c[2] + u * c[3]));
+    }
+
+    // Walk from piece i (a valid guess) to the piece of t.
+    size_t advance(size_t i, double t) const;
+
+    vector<double> X;
+    vector<double> Coeffs; // 4 per piece
+    bool Uniform = false;
+    double InvH = 0;       // 1 / spacing, when Uniform
+};
+
+#endif // CUBICSPLINE_H
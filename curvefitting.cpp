@@ -1,4 +1,5 @@
 #include "curvefitting.h"
+#include "compiledfunction.h"
 
 class Matrix {
 private:
@@ -161,24 +162,33 @@ public:
 };
 
 CurveResult CurveFitting::linear(const ex &c_x,const ex &c_y,const vector<double> &x,const vector<double> &y,symbol xs,symbol ys)
+{
+    return linear(CompiledFunction(c_x, xs), CompiledFunction(c_y, ys), x, y);
+}
+
+CurveResult CurveFitting::linear(const ExpressionHandle &c_x, const ExpressionHandle &c_y, const vector<double> &x, const vector<double> &y)
+{
+    return linear(c_x->function(), c_y->function(), x, y);
+}
+
+CurveResult CurveFitting::linear(const CompiledFunction &fx, const CompiledFunction &fy, const vector<double> &x, const vector<double> &y)
 {
     CurveResult CR;
     CR.sum_X = CR.sum_Y = CR.sum_XY = CR.sum_X2 = 0;
     int n = x.size();
+    vector<double> CX(n), CY(n);
+    fx.evalBatch(x.data(), CX.data(), n);
+    fy.evalBatch(y.data(), CY.data(), n);
 
     for (int i = 0; i < n; ++i) {
-        double cx, cy;
-
-        try {
-            cx = ex_to<numeric>(c_x.subs(xs == x[i])).to_double();
-        } catch (...) {
+        double cx = CX[i];
+        if (isnan(cx)) {
             cerr << "could not resolve cx\n";
             return CR;
         }
 
-        try {
-            cy = ex_to<numeric>(c_y.subs(ys == y[i])).to_double();
-        } catch (...) {
+        double cy = CY[i];
+        if (isnan(cy)) {
             cerr << "could not resolve cy\n";
             return CR;
         }
@@ -204,15 +214,26 @@ CurveResult CurveFitting::linear(const ex &c_x,const ex &c_y,const vector<double
 }
 
 CurveResult CurveFitting::quadric(const ex &c_x, const ex &c_y, const vector<double> &x, const vector<double> &y, symbol xs, symbol ys)
+{
+    return quadric(CompiledFunction(c_x, xs), CompiledFunction(c_y, ys), x, y);
+}
+
+CurveResult CurveFitting::quadric(const ExpressionHandle &c_x, const ExpressionHandle &c_y, const vector<double> &x, const vector<double> &y)
+{
+    return quadric(c_x->function(), c_y->function(), x, y);
+}
+
+CurveResult CurveFitting::quadric(const CompiledFunction &fx, const CompiledFunction &fy, const vector<double> &x, const vector<double> &y)
 {
     CurveResult CR;
     CR.sum_X = CR.sum_Y = CR.sum_XY = CR.sum_X2 = CR.sum_X2Y= CR.sum_X3 = CR.sum_X4= 0;
     int n = x.size();
+    CR.X.resize(n);
+    CR.Y.resize(n);
+    fx.evalBatch(x.data(), CR.X.data(), n);
+    fy.evalBatch(y.data(), CR.Y.data(), n);
 
     for (int i = 0; i < n; ++i) {
-        CR.X.push_back(ex_to<numeric>(c_x.subs(xs == x[i])).to_double());
-        CR.Y.push_back(ex_to<numeric>(c_y.subs(ys == y[i])).to_double());
-
         CR.XY.push_back(CR.X[i] * CR.Y[i]);
         CR.X2.push_back(CR.X[i] * CR.X[i]);
 
@@ -311,3 +332,20 @@ CurveResult CurveFitting::exponential(const ex &c_x, const ex &c_y, const vector
 
     return CR;
 }
+
+// The log-linearized models take the log of the column transforms
+// symbolically, so they share the ex overloads' bodies.
+CurveResult CurveFitting::power1(const ExpressionHandle &c_x, const ExpressionHandle &c_y, const vector<double> &x, const vector<double> &y)
+{
+    return power1(c_x->expr(), c_y->expr(), x, y, c_x->variable(), c_y->variable());
+}
+
+CurveResult CurveFitting::power2(const ExpressionHandle &c_x, const ExpressionHandle &c_y, const vector<double> &x, const vector<double> &y)
+{
+    return power2(c_x->expr(), c_y->expr(), x, y, c_x->variable(), c_y->variable());
+}
+
+CurveResult CurveFitting::exponential(const ExpressionHandle &c_x, const ExpressionHandle &c_y, const vector<double> &x, const vector<double> &y)
+{
+    return exponential(c_x->expr(), c_y->expr(), x, y, c_x->variable(), c_y->variable());
+}
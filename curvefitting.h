@@ -3,6 +3,10 @@
 
 #include <ginac/ginac.h>
 #include <cmath>
+
+#include "compiledfunction.h"
+#include "expressionregistry.h"
+
 using namespace std;
 using namespace GiNaC;
 
@@ -30,6 +34,16 @@ public:
     CurveResult power2(const ex &c_x, const ex &c_y, const vector<double> &x, const vector<double> &y, symbol xs, symbol ys);
     CurveResult exponential(const ex &c_x, const ex &c_y, const vector<double> &x, const vector<double> &y, symbol xs, symbol ys);
 
+    // Column transforms from the expression registry: c_x in "x", c_y in "y".
+    CurveResult linear(const ExpressionHandle &c_x, const ExpressionHandle &c_y, const vector<double> &x, const vector<double> &y);
+    CurveResult quadric(const ExpressionHandle &c_x, const ExpressionHandle &c_y, const vector<double> &x, const vector<double> &y);
+    CurveResult power1(const ExpressionHandle &c_x, const ExpressionHandle &c_y, const vector<double> &x, const vector<double> &y);
+    CurveResult power2(const ExpressionHandle &c_x, const ExpressionHandle &c_y, const vector<double> &x, const vector<double> &y);
+    CurveResult exponential(const ExpressionHandle &c_x, const ExpressionHandle &c_y, const vector<double> &x, const vector<double> &y);
+
+    CurveResult linear(const CompiledFunction &fx, const CompiledFunction &fy, const vector<double> &x, const vector<double> &y);
+    CurveResult quadric(const CompiledFunction &fx, const CompiledFunction &fy, const vector<double> &x, const vector<double> &y);
+
 
 
 };
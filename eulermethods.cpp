@@ -1,11 +1,26 @@
 #include "eulermethods.h"
 
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
 
-double eval_xy(const ex &fxy, symbol x, symbol y, double x_, double y_){
-    return ex_to<numeric>(fxy.subs(lst{x == x_, y == y_}.evalf())).to_double();
+
+double eval_xy(const CompiledFunction &fxy, double x_, double y_){
+    return fxy(x_, y_);
 }
 
 EulerResult EulerMethods::Euler(const ex &fxy, symbol x, symbol y, double x0, double y0, double x_, double h)
+{
+    return Euler(CompiledFunction(fxy, {x, y}), x0, y0, x_, h);
+}
+
+EulerResult EulerMethods::Euler(const ExpressionHandle &fxy, double x0, double y0, double x_, double h)
+{
+    return Euler(fxy->function(), x0, y0, x_, h);
+}
+
+EulerResult EulerMethods::Euler(const CompiledFunction &f, double x0, double y0, double x_, double h)
 {
     EulerResult R;
     R.Y.push_back(y0);
@@ -17,15 +32,27 @@ EulerResult EulerMethods::Euler(const ex &fxy, symbol x, symbol y, double x0, do
     int size = R.X.size();
 
     for (int i = 1; i < size; ++i) {
-        double Fxy_v = eval_xy(fxy, x, y, R.X[i-1], R.Y[i-1]);
+        double Fxy_v = eval_xy(f, R.X[i-1], R.Y[i-1]);
         R.Fxy.push_back(Fxy_v);
         R.Y.push_back(R.Y[i-1] + (h * Fxy_v));
     }
+    R.Accepted = size - 1;
+    R.Evaluations = size - 1;
 
     return R;
 }
 
 EulerResult EulerMethods::Euler(const ex &fxy, symbol x, symbol y, double x0, double y0, pair<double, double> x_, double h)
+{
+    return Euler(CompiledFunction(fxy, {x, y}), x0, y0, x_, h);
+}
+
+EulerResult EulerMethods::Euler(const ExpressionHandle &fxy, double x0, double y0, pair<double, double> x_, double h)
+{
+    return Euler(fxy->function(), x0, y0, x_, h);
+}
+
+EulerResult EulerMethods::Euler(const CompiledFunction &f, double x0, double y0, pair<double, double> x_, double h)
 {
     EulerResult R;
     R.Y.push_back(y0);
@@ -39,15 +66,27 @@ EulerResult EulerMethods::Euler(const ex &fxy, symbol x, symbol y, double x0, do
     int size = R.X.size();
 
     for (int i = 1; i < size; ++i) {
-        double Fxy_v = eval_xy(fxy, x, y, R.X[i-1], R.Y[i-1]);
+        double Fxy_v = eval_xy(f, R.X[i-1], R.Y[i-1]);
         R.Fxy.push_back(Fxy_v);
         R.Y.push_back(R.Y[i-1] + (h * Fxy_v));
     }
+    R.Accepted = size - 1;
+    R.Evaluations = size - 1;
 
     return R;
 }
 
 EulerResult EulerMethods::ModifiedEuler(const ex &fxy, symbol x, symbol y, double x0, double y0, double x_, double h)
+{
+    return ModifiedEuler(CompiledFunction(fxy, {x, y}), x0, y0, x_, h);
+}
+
+EulerResult EulerMethods::ModifiedEuler(const ExpressionHandle &fxy, double x0, double y0, double x_, double h)
+{
+    return ModifiedEuler(fxy->function(), x0, y0, x_, h);
+}
+
+EulerResult EulerMethods::ModifiedEuler(const CompiledFunction &f, double x0, double y0, double x_, double h)
 {
     EulerResult R;
     R.Y.push_back(y0);
@@ -59,9 +98,9 @@ EulerResult EulerMethods::ModifiedEuler(const ex &fxy, symbol x, symbol y, doubl
     int size = R.X.size();
 
     for (int i = 1; i < size; ++i) {
-        double Fxy_v = eval_xy(fxy, x, y, R.X[i-1], R.Y.back());
+        double Fxy_v = eval_xy(f, R.X[i-1], R.Y.back());
         double yn_n1 = R.Y.back() + (h * Fxy_v);
-        double Fxyn1_v = eval_xy(fxy, x, y, R.X[i], yn_n1);
+        double Fxyn1_v = eval_xy(f, R.X[i], yn_n1);
         double yn1_n1 = R.Y.back() + (h/2) * (Fxy_v + Fxyn1_v);
 
         R.Fxy.push_back(Fxy_v);
@@ -70,6 +109,239 @@ EulerResult EulerMethods::ModifiedEuler(const ex &fxy, symbol x, symbol y, doubl
         R.Y.push_back(yn1_n1);
 
     }
+    R.Accepted = size - 1;
+    R.Evaluations = 2 * (size - 1);
+
+    return R;
+}
+
+EulerResult EulerMethods::RungeKutta4(const ex &fxy, symbol x, symbol y, double x0, double y0, double x_, double h)
+{
+    return RungeKutta4(CompiledFunction(fxy, {x, y}), x0, y0, x_, h);
+}
+
+EulerResult EulerMethods::RungeKutta4(const ExpressionHandle &fxy, double x0, double y0, double x_, double h)
+{
+    return RungeKutta4(fxy->function(), x0, y0, x_, h);
+}
+
+EulerResult EulerMethods::RungeKutta4(const CompiledFunction &f, double x0, double y0, double x_, double h)
+{
+    EulerResult R;
+    R.h = h;
+    if (!(h > 0)) {
+        cerr << "Runge-Kutta needs a step h > 0.\n";
+        return R;
+    }
+    R.X.push_back(x0);
+    R.Y.push_back(y0);
+
+    // x_n = x0 + n h, as in Euler; a remainder below 1e-9 h is rounding.
+    const long steps = x_ > x0 ? long(ceil((x_ - x0) / h - 1e-9)) : 0;
+    for (long i = 0; i < steps; ++i) {
+        const double xa = R.X.back(), ya = R.Y.back();
+        const double xb = i + 1 == steps ? x_ : x0 + (i + 1) * h;
+        const double step = xb - xa;
+
+        const double k1 = eval_xy(f, xa, ya);
+        const double k2 = eval_xy(f, xa + step / 2, ya + step / 2 * k1);
+        const double k3 = eval_xy(f, xa + step / 2, ya + step / 2 * k2);
+        const double k4 = eval_xy(f, xb, ya + step * k3);
+
+        R.Fxy.push_back(k1);
+        R.X.push_back(xb);
+        R.Y.push_back(ya + step / 6 * (k1 + 2 * k2 + 2 * k3 + k4));
+    }
+    R.Accepted = steps;
+    R.Evaluations = 4 * steps;
+
+    return R;
+}
+
+void DenseOutput::append(double x0, double x1, const double r[5])
+{
+    X.push_back(x0);
+    H.push_back(x1 - x0);
+    R.insert(R.end(), r, r + 5);
+    End = x1;
+}
+
+double DenseOutput::interpolate(size_t step, double x) const
+{
+    const double *r = &R[5 * step];
+    const double s = (x - X[step]) / H[step], s1 = 1 - s;
+    return r[0] + s * (r[1] + s1 * (r[2] + s * (r[3] + s1 * r[4])));
+}
+
+double DenseOutput::operator()(double x) const
+{
+    if (X.empty() || !(x >= X.front() && x <= End))
+        return NAN;
+    const size_t step = upper_bound(X.begin(), X.end(), x) - X.begin() - 1;
+    return interpolate(step, x);
+}
+
+void DenseOutput::evalBatch(const double *x, double *out, size_t n) const
+{
+    size_t step = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (X.empty() || !(x[i] >= X.front() && x[i] <= End)) {
+            out[i] = NAN;
+            continue;
+        }
+        if (x[i] < X[step]) {
+            step = upper_bound(X.begin(), X.begin() + step, x[i]) - X.begin() - 1;
+        } else {
+            // Gallop forward from the last step, then search the bracket.
+            size_t hi = step + 1, width = 1;
+            while (hi < X.size() && X[hi] <= x[i]) {
+                step = hi;
+                hi = min(X.size(), hi + width);
+                width *= 2;
+            }
+            step = upper_bound(X.begin() + step, X.begin() + hi, x[i]) - X.begin() - 1;
+        }
+        out[i] = interpolate(step, x[i]);
+    }
+}
+
+// Dormand-Prince 5(4) tableau.
+namespace {
+const double C2 = 1.0 / 5, C3 = 3.0 / 10, C4 = 4.0 / 5, C5 = 8.0 / 9;
+const double A21 = 1.0 / 5;
+const double A31 = 3.0 / 40, A32 = 9.0 / 40;
+const double A41 = 44.0 / 45, A42 = -56.0 / 15, A43 = 32.0 / 9;
+const double A51 = 19372.0 / 6561, A52 = -25360.0 / 2187, A53 = 64448.0 / 6561, A54 = -212.0 / 729;
+const double A61 = 9017.0 / 3168, A62 = -355.0 / 33, A63 = 46732.0 / 5247, A64 = 49.0 / 176,
+             A65 = -5103.0 / 18656;
+// Fifth-order weights; also the last row, so stage 7 is f at the new point.
+const double B1 = 35.0 / 384, B3 = 500.0 / 1113, B4 = 125.0 / 192, B5 = -2187.0 / 6784, B6 = 11.0 / 84;
+// Fifth- minus fourth-order weights.
+const double E1 = 71.0 / 57600, E3 = -71.0 / 16695, E4 = 71.0 / 1920, E5 = -17253.0 / 339200,
+             E6 = 22.0 / 525, E7 = -1.0 / 40;
+// Dense output (Hairer, Norsett and Wanner, DOPRI5).
+const double D1 = -12715105075.0 / 11282082432, D3 = 87487479700.0 / 32700410799,
+             D4 = -10690763975.0 / 1880347072, D5 = 701980252875.0 / 199316789632,
+             D6 = -1453857185.0 / 822651844, D7 = 69997945.0 / 29380423;
+}
+
+EulerResult EulerMethods::DormandPrince(const ex &fxy, symbol x, symbol y, double x0, double y0, double x_,
+                                        double rtol, double atol, const vector<double> &at, int maxSteps)
+{
+    return DormandPrince(CompiledFunction(fxy, {x, y}), x0, y0, x_, rtol, atol, at, maxSteps);
+}
+
+EulerResult EulerMethods::DormandPrince(const ExpressionHandle &fxy, double x0, double y0, double x_,
+                                        double rtol, double atol, const vector<double> &at, int maxSteps)
+{
+    return DormandPrince(fxy->function(), x0, y0, x_, rtol, atol, at, maxSteps);
+}
+
+EulerResult EulerMethods::DormandPrince(const CompiledFunction &f, double x0, double y0, double x_,
+                                        double rtol, double atol, const vector<double> &at, int maxSteps)
+{
+    EulerResult R;
+    R.h = NAN;
+    if (!(x_ > x0)) {
+        cerr << "Dormand-Prince needs x_ > x0.\n";
+        return R;
+    }
+    if (!(rtol >= 0 && atol >= 0 && rtol + atol > 0)) {
+        cerr << "Dormand-Prince needs rtol, atol >= 0, not both 0.\n";
+        return R;
+    }
+    R.X.push_back(x0);
+    R.Y.push_back(y0);
+
+    double x = x0, y = y0;
+    double k1 = eval_xy(f, x, y);
+    R.Evaluations = 1;
+    if (!isfinite(k1)) {
+        cerr << "f(x0, y0) is not finite.\n";
+        return R;
+    }
+
+    // First step (Hairer, Norsett and Wanner, II.4): make the Euler step
+    // small relative to y, then size it by an estimate of y''.
+    double h;
+    {
+        const double scale = atol + rtol * fabs(y);
+        const double d0 = fabs(y) / scale, d1 = fabs(k1) / scale;
+        const double h0 = min(d0 < 1e-5 || d1 < 1e-5 ? 1e-6 : 0.01 * d0 / d1, x_ - x0);
+        const double k = eval_xy(f, x + h0, y + h0 * k1);
+        ++R.Evaluations;
+        const double d2 = fabs(k - k1) / scale / h0;
+        const double dmax = max(d1, d2);
+        const double h1 = isfinite(d2) ? (dmax <= 1e-15 ? max(1e-6, h0 * 1e-3) : pow(0.01 / dmax, 0.2)) : h0;
+        h = min({100 * h0, h1, x_ - x0});
+    }
+    R.h = h;
+
+    auto dense = make_shared<DenseOutput>();
+    bool rejected = false;
+    while (x < x_) {
+        if (R.Accepted >= maxSteps) {
+            cerr << "Dormand-Prince stopped after " << maxSteps << " steps at x = " << x << ".\n";
+            break;
+        }
+        if (h < 16 * numeric_limits<double>::epsilon() * max(1.0, fabs(x))) {
+            cerr << "Dormand-Prince step size underflow at x = " << x << ".\n";
+            break;
+        }
+        // Stretch a step that would leave a sliver before x_.
+        const bool last = x + 1.01 * h >= x_;
+        if (last)
+            h = x_ - x;
+
+        const double k2 = eval_xy(f, x + C2 * h, y + h * A21 * k1);
+        const double k3 = eval_xy(f, x + C3 * h, y + h * (A31 * k1 + A32 * k2));
+        const double k4 = eval_xy(f, x + C4 * h, y + h * (A41 * k1 + A42 * k2 + A43 * k3));
+        const double k5 = eval_xy(f, x + C5 * h, y + h * (A51 * k1 + A52 * k2 + A53 * k3 + A54 * k4));
+        const double k6 = eval_xy(f, x + h, y + h * (A61 * k1 + A62 * k2 + A63 * k3 + A64 * k4 + A65 * k5));
+        const double y1 = y + h * (B1 * k1 + B3 * k3 + B4 * k4 + B5 * k5 + B6 * k6);
+        const double x1 = last ? x_ : x + h;
+        const double k7 = eval_xy(f, x1, y1);
+        R.Evaluations += 6;
+
+        double err = fabs(h * (E1 * k1 + E3 * k3 + E4 * k4 + E5 * k5 + E6 * k6 + E7 * k7))
+                     / (atol + rtol * max(fabs(y), fabs(y1)));
+        // A stage that left the domain of f: retry with the smallest factor.
+        if (!isfinite(err))
+            err = INFINITY;
+
+        if (err <= 1) {
+            const double ydiff = y1 - y, bspl = h * k1 - ydiff;
+            const double r[5] = {y, ydiff, bspl, ydiff - h * k7 - bspl,
+                                 h * (D1 * k1 + D3 * k3 + D4 * k4 + D5 * k5 + D6 * k6 + D7 * k7)};
+            dense->append(x, x1, r);
+
+            R.Fxy.push_back(k1);
+            R.X.push_back(x1);
+            R.Y.push_back(y1);
+            ++R.Accepted;
+            x = x1;
+            y = y1;
+            k1 = k7; // FSAL
+
+            double factor = err == 0 ? 10 : min(10.0, max(0.2, 0.9 * pow(err, -0.2)));
+            // Right after a rejection, do not grow again at once.
+            if (rejected)
+                factor = min(factor, 1.0);
+            rejected = false;
+            h *= factor;
+        } else {
+            ++R.Rejected;
+            rejected = true;
+            h *= max(0.2, 0.9 * pow(err, -0.2));
+        }
+    }
+
+    if (!at.empty()) {
+        R.XDense = at;
+        R.YDense.resize(at.size());
+        dense->evalBatch(at.data(), R.YDense.data(), at.size());
+    }
+    R.Dense = dense;
 
     return R;
 }
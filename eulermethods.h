@@ -2,12 +2,50 @@
 #define EULERMETHODS_H
 
 #include <ginac/ginac.h>
+#include <memory>
+
+#include "compiledfunction.h"
+#include "expressionregistry.h"
 
 
 
 using namespace std;
 using namespace GiNaC;
 
+/**
+ * Continuous solution of a Dormand-Prince run. Each accepted step keeps
+ * the five coefficients of the method's fourth-order interpolant, built
+ * from stages the step computed anyway, so y can be read at any x in the
+ * run's range without extra evaluations of f or smaller steps.
+ */
+class DenseOutput
+{
+public:
+    bool valid() const { return !X.empty(); }
+    size_t steps() const { return X.size(); }
+    double lower() const { return X.empty() ? NAN : X.front(); }
+    double upper() const { return End; }
+
+    /** Add the step [x0, x1], x0 being the previous step's end, with interpolant coefficients r[0..4]. */
+    void append(double x0, double x1, const double r[5]);
+
+    /** y(x), NaN outside [lower(), upper()]. */
+    double operator()(double x) const;
+
+    /**
+     * y at x[0..n-1]. Nondecreasing queries walk forward through the
+     * steps instead of searching for each one.
+     */
+    void evalBatch(const double *x, double *out, size_t n) const;
+
+private:
+    double interpolate(size_t step, double x) const;
+
+    vector<double> X, H; // start and length of each step
+    vector<double> R;    // 5 coefficients per step
+    double End = NAN;
+};
+
 struct EulerResult{
 
     vector<double> X;
@@ -18,6 +56,15 @@ struct EulerResult{
 
     vector<double> Fxy;
     vector<double> Fxy_P; // Modified Euler Only
+
+    int Accepted = 0;       // steps taken
+    int Rejected = 0;       // Dormand-Prince only: steps retried with a smaller h
+    size_t Evaluations = 0; // calls of f(x, y)
+
+    // Dormand-Prince only: the solution at the requested x, and everywhere
+    vector<double> XDense;
+    vector<double> YDense;
+    shared_ptr<const DenseOutput> Dense;
 };
 
 class EulerMethods
@@ -26,10 +73,55 @@ class EulerMethods
 public:
     EulerResult Euler(const ex &fxy, symbol x, symbol y, double x0, double y0, double x_, double h);
     EulerResult Euler(const ex &fxy, symbol x, symbol y, double x0, double y0, pair<double, double> x_, double h);
+    EulerResult Euler(const CompiledFunction &fxy, double x0, double y0, double x_, double h);
+    EulerResult Euler(const CompiledFunction &fxy, double x0, double y0, pair<double, double> x_, double h);
+    EulerResult Euler(const ExpressionHandle &fxy, double x0, double y0, double x_, double h);
+    EulerResult Euler(const ExpressionHandle &fxy, double x0, double y0, pair<double, double> x_, double h);
 
     EulerResult ModifiedEuler(const ex &fxy, symbol x, symbol y, double x0, double y0, double x_, double h);
+    EulerResult ModifiedEuler(const CompiledFunction &fxy, double x0, double y0, double x_, double h);
+    EulerResult ModifiedEuler(const ExpressionHandle &fxy, double x0, double y0, double x_, double h);
     // EulerResult ModifiedEuler(const ex &fxy, symbol x, symbol y, double x0, double y0, pair<double, double> x_, double h);
 
+    /**
+     * Classic fourth-order Runge-Kutta with fixed step h; the last step is
+     * shortened to end on x_. Four evaluations of f per step, with the
+     * global error O(h^4) instead of Euler's O(h).
+     *
+     * @return  X, Y at every step and Fxy = f(X, Y) at each step start
+     */
+    EulerResult RungeKutta4(const ex &fxy, symbol x, symbol y, double x0, double y0, double x_, double h);
+    EulerResult RungeKutta4(const CompiledFunction &fxy, double x0, double y0, double x_, double h);
+    EulerResult RungeKutta4(const ExpressionHandle &fxy, double x0, double y0, double x_, double h);
+
+    /**
+     * Adaptive Runge-Kutta 5(4) of Dormand and Prince from x0 to x_.
+     *
+     * Each step estimates its error from the embedded fourth-order
+     * solution and is accepted when |err| <= atol + rtol * |y|; h then
+     * grows or shrinks by (1 / err)^(1/5), within [0.2, 10] times. The
+     * last stage of a step is f at its end point, which is the first stage
+     * of the next (FSAL), so an accepted step costs six evaluations of f.
+     * The first h is chosen from f(x0, y0) and one more evaluation.
+     *
+     * @param at        Points in [x0, x_] to report in XDense/YDense, from
+     *                  the dense output; they do not limit the step size
+     * @param maxSteps  Give up (with a message on cerr) after this many
+     *                  accepted steps
+     * @return  X, Y at the accepted steps, Fxy = f(X, Y) at each step start,
+     *          h the first step, the step counts and the dense output. Stops early, keeping
+     *          what was done, when f is not finite or h underflows.
+     */
+    EulerResult DormandPrince(const ex &fxy, symbol x, symbol y, double x0, double y0, double x_,
+                              double rtol = 1e-8, double atol = 1e-10, const vector<double> &at = {},
+                              int maxSteps = 1000000);
+    EulerResult DormandPrince(const CompiledFunction &fxy, double x0, double y0, double x_,
+                              double rtol = 1e-8, double atol = 1e-10, const vector<double> &at = {},
+                              int maxSteps = 1000000);
+    EulerResult DormandPrince(const ExpressionHandle &fxy, double x0, double y0, double x_,
+                              double rtol = 1e-8, double atol = 1e-10, const vector<double> &at = {},
+                              int maxSteps = 1000000);
+
 };
 
 #endif // EULERMETHODS_H
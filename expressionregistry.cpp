@@ -0,0 +1,119 @@
+#include "expressionregistry.h"
+
+#include <cctype>
+
+Expression::Expression(const string &text, const vector<string> &names)
+    : Text(text)
+{
+    symtab table;
+    for (const string &name : names) {
+        Vars.push_back(symbol(name));
+        table[name] = Vars.back();
+    }
+    table["pi"] = Pi;
+
+    // Strict, so an unknown name like the "a" in "x + a" is a parse error
+    // rather than a free symbol no evaluator can give a number for.
+    parser p(table, true);
+    Expr = p(text);
+    Function = CompiledFunction(Expr, Vars);
+}
+
+const ex &Expression::derivative(size_t wrt) const
+{
+    lock_guard<mutex> lock(DerivativeMutex);
+    auto it = Derivatives.find(wrt);
+    if (it == Derivatives.end())
+        it = Derivatives.emplace(wrt, diff(Expr, Vars[wrt])).first;
+    return it->second;
+}
+
+ExpressionRegistry::ExpressionRegistry(size_t capacity)
+    : Capacity(capacity)
+{
+}
+
+ExpressionRegistry &ExpressionRegistry::instance()
+{
+    static ExpressionRegistry registry;
+    return registry;
+}
+
+string ExpressionRegistry::normalize(const string &text)
+{
+    string out;
+    out.reserve(text.size());
+    bool gap = false;
+    for (unsigned char c : text) {
+        if (isspace(c)) {
+            gap = true;
+            continue;
+        }
+        // One blank per run: "2 3" and "23" must not share a key.
+        if (gap && !out.empty())
+            out += ' ';
+        gap = false;
+        out += c;
+    }
+    return out;
+}
+
+ExpressionHandle ExpressionRegistry::get(const string &text, const vector<string> &variables)
+{
+    string key = normalize(text);
+    for (const string &name : variables) {
+        key += '\n'; // never part of a normalized equation
+        key += name;
+    }
+
+    {
+        lock_guard<mutex> lock(Mutex);
+        auto it = Index.find(key);
+        if (it != Index.end()) {
+            ++Hits;
+            Lru.splice(Lru.begin(), Lru, it->second);
+            return it->second->second;
+        }
+        ++Misses;
+    }
+
+    // Parse and compile outside the lock; a racing miss on the same key just
+    // builds the same entry twice.
+    ExpressionHandle handle = make_shared<const Expression>(text, variables);
+
+    lock_guard<mutex> lock(Mutex);
+    auto it = Index.find(key);
+    if (it != Index.end()) {
+        Lru.splice(Lru.begin(), Lru, it->second);
+        return it->second->second;
+    }
+
+    Lru.emplace_front(key, handle);
+    Index[key] = Lru.begin();
+    while (Lru.size() > Capacity) {
+        Index.erase(Lru.back().first);
+        Lru.pop_back();
+    }
+    return handle;
+}
+
+RegistryStats ExpressionRegistry::stats() const
+{
+    lock_guard<mutex> lock(Mutex);
+    RegistryStats s;
+    s.Hits = Hits;
+    s.Misses = Misses;
+    s.Size = Lru.size();
+    s.Capacity = Capacity;
+    return s;
+}
+
+void ExpressionRegistry::setCapacity(size_t capacity)
+{
+    lock_guard<mutex> lock(Mutex);
+    Capacity = capacity > 0 ? capacity : 1;
+    while (Lru.size() > Capacity) {
+        Index.erase(Lru.back().first);
+        Lru.pop_back();
+    }
+}
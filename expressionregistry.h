@@ -0,0 +1,111 @@
+#ifndef EXPRESSIONREGISTRY_H
+#define EXPRESSIONREGISTRY_H
+
+#include <ginac/ginac.h>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "compiledfunction.h"
+
+using namespace std;
+using namespace GiNaC;
+
+/**
+ * One parsed equation: its text, symbols, ex and compiled evaluator.
+ * Never modified once built, so a handle can be shared between pages. It
+ * still holds GiNaC objects, whose reference counts are not atomic, so only
+ * the compiled tape (function() when isCompiled()) may be used off the GUI
+ * thread.
+ */
+class Expression
+{
+public:
+    /**
+     * Parse `text` with a parser that knows `names` and pi.
+     * Throws GiNaC::parse_error (a std::invalid_argument) on bad input,
+     * including any other name.
+     */
+    Expression(const string &text, const vector<string> &names);
+
+    const string &text() const { return Text; }
+    const ex &expr() const { return Expr; }
+    const symbol &variable(size_t i = 0) const { return Vars[i]; }
+    const vector<symbol> &variables() const { return Vars; }
+    const CompiledFunction &function() const { return Function; }
+
+    /**
+     * Symbolic derivative with respect to variable(wrt), for display.
+     * Computed on first request and kept; solvers use function().jet() instead.
+     */
+    const ex &derivative(size_t wrt = 0) const;
+
+private:
+    string Text;
+    vector<symbol> Vars;
+    ex Expr;
+    CompiledFunction Function;
+
+    mutable mutex DerivativeMutex;
+    mutable map<size_t, ex> Derivatives;
+};
+
+typedef shared_ptr<const Expression> ExpressionHandle;
+
+struct RegistryStats
+{
+    size_t Hits = 0;
+    size_t Misses = 0;   // parses + compilations
+    size_t Size = 0;
+    size_t Capacity = 0;
+
+    double hitRate() const { return Hits + Misses ? double(Hits) / (Hits + Misses) : 0; }
+};
+
+/**
+ * Process-wide cache of parsed equations, shared by every solver page.
+ *
+ * Lookups are keyed by the normalized text plus the variable names, so
+ * re-solving the same F with new bounds, steps or tolerance reuses the
+ * parsed ex and its tape. The least recently used entry is dropped once
+ * `capacity` equations are held; handles already given out stay valid.
+ */
+class ExpressionRegistry
+{
+public:
+    static ExpressionRegistry &instance();
+
+    /**
+     * @param text       Equation as typed (e.g. "x^2 - 2")
+     * @param variables  Names the equation may use, in evaluation order
+     * @return           Shared handle; throws like Expression() on bad input
+     */
+    ExpressionHandle get(const string &text, const vector<string> &variables = {"x"});
+
+    RegistryStats stats() const;
+    void setCapacity(size_t capacity);
+
+    /**
+     * The cache key for text: leading and trailing whitespace dropped and
+     * each inner run collapsed to one blank. Only used for lookups; the
+     * entry is always parsed from the text as given.
+     */
+    static string normalize(const string &text);
+
+private:
+    explicit ExpressionRegistry(size_t capacity = 64);
+
+    typedef list<pair<string, ExpressionHandle>> Entries; // most recent first
+
+    mutable mutex Mutex;
+    Entries Lru;
+    unordered_map<string, Entries::iterator> Index;
+    size_t Capacity;
+    size_t Hits = 0, Misses = 0;
+};
+
+#endif // EXPRESSIONREGISTRY_H
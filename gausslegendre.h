@@ -0,0 +1,119 @@
+#ifndef GAUSSLEGENDRE_H
+#define GAUSSLEGENDRE_H
+
+/**
+ * Gauss–Legendre nodes and weights on [-1, 1], computed by the compiler.
+ *
+ * GaussLegendre<N>::Rule is a constexpr table: the roots of P_N are found
+ * by Newton's method on the three-term recurrence, from Tricomi-style
+ * starting guesses, entirely in constant evaluation. Nothing is computed
+ * or allocated at run time, and any order can be instantiated; the
+ * integrator dispatches to the common ones (see gaussLegendreOrders).
+ */
+
+template <int N>
+struct GaussLegendreRule
+{
+    double X[N] = {}; // increasing
+    double W[N] = {};
+};
+
+namespace gauss_detail {
+
+constexpr double Pi = 3.14159265358979323846;
+
+constexpr double fabs(double x) { return x < 0 ? -x : x; }
+
+// cos on [0, pi] by its Taylor series; only seeds Newton, which then
+// converges to full precision regardless.
+constexpr double cos(double x)
+{
+    double term = 1, sum = 1;
+    for (int k = 1; k < 40; ++k) {
+        term *= -x * x / ((2 * k - 1) * (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// P_N(x) and P_N'(x) by the recurrence (k+1) P_{k+1} = (2k+1) x P_k - k P_{k-1}.
+constexpr void legendre(int n, double x, double &p, double &dp)
+{
+    double p0 = 1, p1 = x;
+    for (int k = 1; k < n; ++k) {
+        const double p2 = ((2 * k + 1) * x * p1 - k * p0) / (k + 1);
+        p0 = p1;
+        p1 = p2;
+    }
+    p = n == 0 ? 1 : p1;
+    dp = n * (x * p1 - p0) / (x * x - 1);
+}
+
+} // namespace gauss_detail
+
+template <int N>
+constexpr GaussLegendreRule<N> gaussLegendreRule()
+{
+    static_assert(N >= 1, "Gauss-Legendre needs at least one node");
+    GaussLegendreRule<N> rule;
+    for (int i = 0; i < (N + 1) / 2; ++i) {
+        // i-th largest root
+        double x = gauss_detail::cos(gauss_detail::Pi * (i + 0.75) / (N + 0.5));
+        double p = 0, dp = 0;
+        for (int it = 0; it < 100; ++it) {
+            gauss_detail::legendre(N, x, p, dp);
+            const double dx = p / dp;
+            x -= dx;
+            if (gauss_detail::fabs(dx) <= 1e-17)
+                break;
+        }
+        gauss_detail::legendre(N, x, p, dp);
+        const double w = 2 / ((1 - x * x) * dp * dp);
+
+        rule.X[N - 1 - i] = x;
+        rule.W[N - 1 - i] = w;
+        rule.X[i] = -x;
+        rule.W[i] = w;
+    }
+    if (N % 2 == 1)
+        rule.X[N / 2] = 0; // exact centre node
+    return rule;
+}
+
+template <int N>
+struct GaussLegendre
+{
+    static constexpr GaussLegendreRule<N> Rule = gaussLegendreRule<N>();
+};
+
+/** Orders IntegrationMethods::gaussLegendre() accepts. */
+constexpr int gaussLegendreOrders[] = {2, 3, 4, 5, 6, 8, 10, 12, 16, 20, 32, 64};
+
+/**
+ * Table of a run-time order, for rules built per call (e.g. tensor products).
+ * @return  false, leaving x and w alone, for orders not in gaussLegendreOrders
+ */
+inline bool gaussLegendreTable(int order, const double *&x, const double *&w)
+{
+    switch (order) {
+#define GAUSS_LEGENDRE_CASE(N) \
+    case N: x = GaussLegendre<N>::Rule.X; w = GaussLegendre<N>::Rule.W; return true;
+    GAUSS_LEGENDRE_CASE(2)
+    GAUSS_LEGENDRE_CASE(3)
+    GAUSS_LEGENDRE_CASE(4)
+    GAUSS_LEGENDRE_CASE(5)
+    GAUSS_LEGENDRE_CASE(6)
+    GAUSS_LEGENDRE_CASE(8)
+    GAUSS_LEGENDRE_CASE(10)
+    GAUSS_LEGENDRE_CASE(12)
+    GAUSS_LEGENDRE_CASE(16)
+    GAUSS_LEGENDRE_CASE(20)
+    GAUSS_LEGENDRE_CASE(32)
+    GAUSS_LEGENDRE_CASE(64)
+#undef GAUSS_LEGENDRE_CASE
+    default:
+        return false;
+    }
+}
+
+#endif // GAUSSLEGENDRE_H
@@ -1,14 +1,44 @@
 #include "integrationmethods.h"
+#include "gausslegendre.h"
+#include "sobol.h"
 
-IntegrationResult StartingTable(const ex &f_expr, symbol x, double a, double b, int n){
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+// f at x[0..n-1], in fixed chunks spread over the thread pool (when f has a
+// tape; GiNaC is not thread-safe). Values are pointwise, so they do not
+// depend on the thread count.
+static void evalParallel(const CompiledFunction &f, const double *x, double *out, size_t n)
+{
+    const size_t Chunk = 32768;
+    const size_t chunks = (n + Chunk - 1) / Chunk;
+    if (chunks <= 1 || !f.isCompiled()) {
+        f.evalBatch(x, out, n);
+        return;
+    }
+    ThreadPool::instance().parallelFor(chunks, [&](size_t c) {
+        const size_t first = c * Chunk;
+        f.evalBatch(x + first, out + first, min(Chunk, n - first));
+    });
+}
+
+IntegrationResult StartingTable(const CompiledFunction &f, double a, double b, int n){
 
     IntegrationResult Result;
     Result.h = (b - a) / n;
 
+    Result.X.resize(n+1);
+    Result.FX.resize(n+1);
+
     for (int i = 0; i < n+1; ++i) {
-        Result.X.push_back(a+(i*Result.h));
-        Result.FX.push_back(ex_to<numeric>(f_expr.subs(x == Result.X.back())).to_double());
+        Result.X[i] = a+(i*Result.h);
     }
+    evalParallel(f, Result.X.data(), Result.FX.data(), n+1);
+    Result.Evaluations = n+1;
 
     return Result;
 }
@@ -16,7 +46,17 @@ IntegrationResult StartingTable(const ex &f_expr, symbol x, double a, double b,
 
 IntegrationResult IntegrationMethods::trapezoidal(const ex &f_expr, symbol x, double a, double b, int n)
 {
-    IntegrationResult Result = StartingTable(f_expr, x, a, b, n);
+    return trapezoidal(CompiledFunction(f_expr, x), a, b, n);
+}
+
+IntegrationResult IntegrationMethods::trapezoidal(const ExpressionHandle &f, double a, double b, int n)
+{
+    return trapezoidal(f->function(), a, b, n);
+}
+
+IntegrationResult IntegrationMethods::trapezoidal(const CompiledFunction &f, double a, double b, int n)
+{
+    IntegrationResult Result = StartingTable(f, a, b, n);
 
     double Sum = 0;
     for(int i = 1; i < Result.FX.size()-1; ++i){
@@ -30,7 +70,17 @@ IntegrationResult IntegrationMethods::trapezoidal(const ex &f_expr, symbol x, do
 
 IntegrationResult IntegrationMethods::simpsonOneThird(const ex &f_expr, symbol x, double a, double b, int n)
 {
-    IntegrationResult Result = StartingTable(f_expr, x, a, b, n);
+    return simpsonOneThird(CompiledFunction(f_expr, x), a, b, n);
+}
+
+IntegrationResult IntegrationMethods::simpsonOneThird(const ExpressionHandle &f, double a, double b, int n)
+{
+    return simpsonOneThird(f->function(), a, b, n);
+}
+
+IntegrationResult IntegrationMethods::simpsonOneThird(const CompiledFunction &f, double a, double b, int n)
+{
+    IntegrationResult Result = StartingTable(f, a, b, n);
     double Sum_odd = 0,
            Sum_even = 0;
     for(int i = 1; i < Result.FX.size()-1; ++i){
@@ -45,7 +95,17 @@ IntegrationResult IntegrationMethods::simpsonOneThird(const ex &f_expr, symbol x
 
 IntegrationResult IntegrationMethods::simpsonThreeEighth(const ex &f_expr, symbol x, double a, double b, int n)
 {
-    IntegrationResult Result = StartingTable(f_expr, x, a, b, n);
+    return simpsonThreeEighth(CompiledFunction(f_expr, x), a, b, n);
+}
+
+IntegrationResult IntegrationMethods::simpsonThreeEighth(const ExpressionHandle &f, double a, double b, int n)
+{
+    return simpsonThreeEighth(f->function(), a, b, n);
+}
+
+IntegrationResult IntegrationMethods::simpsonThreeEighth(const CompiledFunction &f, double a, double b, int n)
+{
+    IntegrationResult Result = StartingTable(f, a, b, n);
     double Sum_third = 0,
            Sum_norm = 0;
     for(int i = 1; i < Result.FX.size()-1; ++i){
@@ -57,3 +117,979 @@ IntegrationResult IntegrationMethods::simpsonThreeEighth(const ex &f_expr, symbo
 
     return Result;
 }
+
+namespace {
+
+// Running sum with Neumaier's compensation: the low-order bits lost by each
+// addition are collected in C and added back at the end.
+struct NeumaierSum
+{
+    double Sum = 0, C = 0;
+
+    void add(double v)
+    {
+        const double t = Sum + v;
+        if (fabs(Sum) >= fabs(v))
+            C += (Sum - t) + v;
+        else
+            C += (v - t) + Sum;
+        Sum = t;
+    }
+
+    double total() const { return Sum + C; }
+};
+
+// Pairwise sum of v[0..n-1]; error grows with log n instead of n.
+double pairwise(const double *v, size_t n)
+{
+    if (n <= 8) {
+        double s = 0;
+        for (size_t i = 0; i < n; ++i)
+            s += v[i];
+        return s;
+    }
+    const size_t half = n / 2;
+    return pairwise(v, half) + pairwise(v + half, n - half);
+}
+
+// Pairwise across blocks: Level[k] holds the sum of 2^k block sums, merged
+// like a binary counter, so the whole stream is summed as one tree.
+struct PairwiseSum
+{
+    array<double, 64> Level;
+    uint64_t Used = 0;
+
+    void add(double blockSum)
+    {
+        int k = 0;
+        while (Used & (uint64_t(1) << k)) {
+            blockSum += Level[k];
+            Used &= ~(uint64_t(1) << k);
+            ++k;
+        }
+        Level[k] = blockSum;
+        Used |= uint64_t(1) << k;
+    }
+
+    double total() const
+    {
+        double s = 0;
+        for (int k = 0; k < 64; ++k) {
+            if (Used & (uint64_t(1) << k))
+                s += Level[k];
+        }
+        return s;
+    }
+};
+
+} // namespace
+
+IntegrationResult IntegrationMethods::streaming(const ExpressionHandle &f, double a, double b, long long n,
+                                                NewtonCotes rule, Summation sum, size_t samples)
+{
+    return streaming(f->function(), a, b, n, rule, sum, samples);
+}
+
+IntegrationResult IntegrationMethods::streaming(const CompiledFunction &f, double a, double b, long long n,
+                                                NewtonCotes rule, Summation sum, size_t samples,
+                                                ThreadPool &pool)
+{
+    IntegrationResult Result;
+    Result.h = (b - a) / n;
+
+    // Weights of the composite rules, ends excluded, and the prefactor
+    int period = 1;
+    double weights[3] = {2, 2, 2}, factor = Result.h / 2;
+    if (rule == NewtonCotes::SimpsonOneThird) {
+        period = 2;
+        weights[0] = 2;
+        weights[1] = 4;
+        factor = Result.h / 3;
+    } else if (rule == NewtonCotes::SimpsonThreeEighth) {
+        period = 3;
+        weights[0] = 2;
+        weights[1] = weights[2] = 3;
+        factor = 3 * Result.h / 8;
+    }
+
+    // Display sample: node i is kept in slot i / stride, plus the last node
+    const long long stride = samples ? max(1LL, (n + 1) / (long long)samples) : 0;
+    if (samples) {
+        const size_t kept = size_t(n / stride) + 1 + (n % stride != 0);
+        Result.X.resize(kept);
+        Result.FX.resize(kept);
+    }
+
+    // Fixed panels of whole Simpson groups, independent of the pool size
+    const long long Panel = 6 * 5461; // 32766 nodes
+    const size_t Block = 4096;
+    const size_t panels = size_t(n / Panel) + 1;
+    vector<double> partial(panels);
+
+    auto sumPanel = [&](size_t p) {
+        const long long first = (long long)p * Panel;
+        const long long last = min(first + Panel, n + 1); // one past
+        array<double, Block> x, fx;
+        NeumaierSum compensated;
+        PairwiseSum tree;
+
+        for (long long start = first; start < last; start += Block) {
+            const size_t m = size_t(min<long long>(Block, last - start));
+            for (size_t k = 0; k < m; ++k)
+                x[k] = a + ((start + k) * Result.h);
+            f.evalBatch(x.data(), fx.data(), m);
+
+            for (size_t k = 0; k < m; ++k) {
+                const long long i = start + k;
+                if (stride && (i % stride == 0 || i == n)) {
+                    const size_t slot = i % stride == 0 ? size_t(i / stride) : Result.X.size() - 1;
+                    Result.X[slot] = x[k];
+                    Result.FX[slot] = fx[k];
+                }
+                // x is free now: reuse it for the weighted values
+                x[k] = (i == 0 || i == n ? 1.0 : weights[i % period]) * fx[k];
+            }
+
+            if (sum == Summation::Pairwise) {
+                tree.add(pairwise(x.data(), m));
+            } else {
+                for (size_t k = 0; k < m; ++k)
+                    compensated.add(x[k]);
+            }
+        }
+        partial[p] = sum == Summation::Pairwise ? tree.total() : compensated.total();
+    };
+
+    // Without a tape f goes through GiNaC, which is not thread-safe.
+    if (f.isCompiled()) {
+        pool.parallelFor(panels, sumPanel);
+    } else {
+        for (size_t p = 0; p < panels; ++p)
+            sumPanel(p);
+    }
+
+    Result.Evaluations = n + 1;
+    Result.I = factor * pairwise(partial.data(), partial.size());
+    return Result;
+}
+
+vector<ScalingPoint> IntegrationMethods::streamingScaling(const CompiledFunction &f, double a, double b,
+                                                          long long n, NewtonCotes rule, unsigned maxThreads)
+{
+    IntegrationMethods methods;
+    vector<ScalingPoint> points;
+    for (unsigned t = 1; t <= max(maxThreads, 1u); ++t) {
+        ThreadPool pool(t);
+        const auto start = chrono::steady_clock::now();
+        const IntegrationResult r = methods.streaming(f, a, b, n, rule, Summation::Neumaier, 0, pool);
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        points.push_back({t, elapsed.count(), r.I});
+    }
+    return points;
+}
+
+IntegrationResult IntegrationMethods::romberg(const ExpressionHandle &f, double a, double b, int n,
+                                              double absTol, double relTol, int maxLevels)
+{
+    return romberg(f->function(), a, b, n, absTol, relTol, maxLevels);
+}
+
+IntegrationResult IntegrationMethods::romberg(const CompiledFunction &f, double a, double b, int n,
+                                              double absTol, double relTol, int maxLevels)
+{
+    IntegrationResult Result = StartingTable(f, a, b, n);
+
+    double Sum = 0;
+    for (size_t i = 1; i + 1 < Result.FX.size(); ++i)
+        Sum += Result.FX[i];
+    Result.Tableau.push_back({(Result.h / 2) * (Result.FX.front() + Result.FX.back() + 2 * Sum)});
+    Result.I = Result.Tableau[0][0];
+
+    // Only the running trapezoid sum is carried between levels; the new
+    // midpoints are generated and summed a block at a time, so memory stays
+    // bounded however many levels run. X/FX keep the starting grid.
+    const size_t Block = size_t(1) << 18;
+    vector<double> mid, fmid;
+    size_t m = Result.X.size() - 1; // intervals of the current trapezoid sum
+    double h = Result.h;
+    for (int k = 1; k <= maxLevels; ++k) {
+        // The new nodes are the midpoints of the current intervals.
+        h /= 2;
+        double midSum = 0;
+        for (size_t first = 0; first < m; first += Block) {
+            const size_t count = min(Block, m - first);
+            mid.resize(count);
+            fmid.resize(count);
+            for (size_t i = 0; i < count; ++i)
+                mid[i] = a + (2 * (first + i) + 1) * h;
+            evalParallel(f, mid.data(), fmid.data(), count);
+            double blockSum = 0;
+            for (size_t i = 0; i < count; ++i)
+                blockSum += fmid[i];
+            midSum += blockSum;
+        }
+        Result.Evaluations += m;
+        m *= 2;
+
+        const vector<double> &prev = Result.Tableau[k - 1];
+        vector<double> row(k + 1);
+        row[0] = prev[0] / 2 + h * midSum;
+        double factor = 1;
+        for (int j = 1; j <= k; ++j) {
+            factor *= 4;
+            row[j] = row[j - 1] + (row[j - 1] - prev[j - 1]) / (factor - 1);
+        }
+        Result.I = row[k];
+        Result.Error = fabs(row[k] - prev[k - 1]);
+        Result.Tableau.push_back(move(row)); // prev is invalid from here
+        Result.h = h;
+
+        // Two levels at least: one agreement can be a coincidence of the
+        // coarse grids (e.g. a periodic f sampled at its zeros).
+        if (k >= 2 && Result.Error <= max(absTol, relTol * fabs(Result.I)))
+            break;
+    }
+    return Result;
+}
+
+template <int N>
+static void gaussLegendrePanels(const CompiledFunction &f, double a, double b, int panels,
+                                IntegrationResult &Result)
+{
+    const GaussLegendreRule<N> &rule = GaussLegendre<N>::Rule;
+    const double h = (b - a) / panels;
+
+    Result.h = h;
+    Result.X.resize(size_t(panels) * N);
+    Result.FX.resize(Result.X.size());
+    for (int p = 0; p < panels; ++p) {
+        const double c = a + (p + 0.5) * h;
+        for (int i = 0; i < N; ++i)
+            Result.X[size_t(p) * N + i] = c + 0.5 * h * rule.X[i];
+    }
+    evalParallel(f, Result.X.data(), Result.FX.data(), Result.X.size());
+    Result.Evaluations = Result.X.size();
+
+    // Panel sums, then the panels pairwise
+    vector<double> panelSum(panels);
+    for (int p = 0; p < panels; ++p) {
+        double sum = 0;
+        for (int i = 0; i < N; ++i)
+            sum += rule.W[i] * Result.FX[size_t(p) * N + i];
+        panelSum[p] = 0.5 * h * sum;
+    }
+    Result.I = pairwise(panelSum.data(), panelSum.size());
+}
+
+IntegrationResult IntegrationMethods::gaussLegendre(const ExpressionHandle &f, double a, double b,
+                                                    int panels, int order)
+{
+    return gaussLegendre(f->function(), a, b, panels, order);
+}
+
+IntegrationResult IntegrationMethods::gaussLegendre(const CompiledFunction &f, double a, double b,
+                                                    int panels, int order)
+{
+    IntegrationResult Result;
+    Result.I = NAN;
+    Result.h = NAN;
+    if (panels <= 0) {
+        cerr << "Gauss-Legendre needs at least one panel.\n";
+        return Result;
+    }
+
+    switch (order) {
+    case 2: gaussLegendrePanels<2>(f, a, b, panels, Result); break;
+    case 3: gaussLegendrePanels<3>(f, a, b, panels, Result); break;
+    case 4: gaussLegendrePanels<4>(f, a, b, panels, Result); break;
+    case 5: gaussLegendrePanels<5>(f, a, b, panels, Result); break;
+    case 6: gaussLegendrePanels<6>(f, a, b, panels, Result); break;
+    case 8: gaussLegendrePanels<8>(f, a, b, panels, Result); break;
+    case 10: gaussLegendrePanels<10>(f, a, b, panels, Result); break;
+    case 12: gaussLegendrePanels<12>(f, a, b, panels, Result); break;
+    case 16: gaussLegendrePanels<16>(f, a, b, panels, Result); break;
+    case 20: gaussLegendrePanels<20>(f, a, b, panels, Result); break;
+    case 32: gaussLegendrePanels<32>(f, a, b, panels, Result); break;
+    case 64: gaussLegendrePanels<64>(f, a, b, panels, Result); break;
+    default:
+        cerr << "No Gauss-Legendre table of order " << order << ".\n";
+    }
+    return Result;
+}
+
+IntegrationResult IntegrationMethods::tanhSinh(const ExpressionHandle &f, double a, double b,
+                                               double absTol, double relTol, int maxLevels)
+{
+    return tanhSinh(f->function(), a, b, absTol, relTol, maxLevels);
+}
+
+IntegrationResult IntegrationMethods::tanhSinh(const CompiledFunction &f, double a, double b,
+                                               double absTol, double relTol, int maxLevels)
+{
+    const double Pi = 3.14159265358979323846;
+    const double c = 0.5 * (a + b), half = 0.5 * (b - a);
+    // Past t = 6.5 the nodes are within 1e-300 of the ends: nothing left.
+    const double tMax = 6.5;
+
+    IntegrationResult Result;
+    vector<double> x, w, fx;
+    double sum = 0; // sum of w * f over every node so far (step 1 weights)
+    double previous = NAN;
+
+    for (int level = 0; level <= maxLevels; ++level) {
+        // New abscissae: t = 0, +-1, +-2, ... at level 0, then the odd
+        // multiples of 2^-level.
+        const double step = ldexp(1.0, -level);
+        x.clear();
+        w.clear();
+        if (level == 0) {
+            x.push_back(c);
+            w.push_back(Pi / 2);
+        }
+        for (double t = level == 0 ? 1 : step; t <= tMax; t += level == 0 ? 1 : 2 * step) {
+            const double s = Pi / 2 * sinh(t);
+            // Distance to the end, 1 - tanh(s), without cancellation
+            const double d = 2 / (exp(2 * s) + 1);
+            const double weight = Pi / 2 * cosh(t) / (cosh(s) * cosh(s));
+            const double left = a + half * d, right = b - half * d;
+            // Each side stops once its node rounds onto the end; near a = 0
+            // the left nodes stay representable far longer than the right.
+            const bool useLeft = left > a, useRight = right < b;
+            if (weight == 0 || (!useLeft && !useRight))
+                break;
+            if (useLeft) {
+                x.push_back(left);
+                w.push_back(weight);
+            }
+            if (useRight) {
+                x.push_back(right);
+                w.push_back(weight);
+            }
+        }
+
+        fx.resize(x.size());
+        evalParallel(f, x.data(), fx.data(), x.size());
+        Result.Evaluations += x.size();
+        for (size_t i = 0; i < x.size(); ++i) {
+            Result.X.push_back(x[i]);
+            Result.FX.push_back(fx[i]);
+        }
+
+        double levelSum = 0;
+        for (size_t i = 0; i < x.size(); ++i)
+            levelSum += w[i] * fx[i];
+        sum += levelSum;
+
+        Result.I = half * step * sum;
+        Result.h = step;
+        if (level > 0) {
+            const double change = fabs(Result.I - previous);
+            // A change that grows again is rounding in the nodes near the
+            // ends; more levels only add evaluations.
+            const bool stalled = level >= 4 && change >= Result.Error;
+            Result.Error = stalled ? max(change, Result.Error) : change;
+            if (stalled || (level >= 3 && Result.Error <= max(absTol, relTol * fabs(Result.I))))
+                break;
+        }
+        previous = Result.I;
+    }
+
+    // Nodes left to right for display
+    vector<size_t> order(Result.X.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&](size_t i, size_t j) { return Result.X[i] < Result.X[j]; });
+    vector<double> X(order.size()), FX(order.size());
+    for (size_t k = 0; k < order.size(); ++k) {
+        X[k] = Result.X[order[k]];
+        FX[k] = Result.FX[order[k]];
+    }
+    Result.X.swap(X);
+    Result.FX.swap(FX);
+    return Result;
+}
+
+IntegrationResult IntegrationMethods::clenshawCurtis(const ExpressionHandle &f, double a, double b,
+                                                    double tol, size_t maxDegree)
+{
+    return clenshawCurtis(f->function(), a, b, tol, maxDegree);
+}
+
+IntegrationResult IntegrationMethods::clenshawCurtis(const CompiledFunction &f, double a, double b,
+                                                    double tol, size_t maxDegree)
+{
+    const ChebyshevProxy proxy(f, a, b, tol, maxDegree);
+    IntegrationResult Result = clenshawCurtis(proxy);
+    Result.Evaluations = proxy.evaluations();
+    return Result;
+}
+
+IntegrationResult IntegrationMethods::clenshawCurtis(const ChebyshevProxy &proxy)
+{
+    IntegrationResult Result;
+    Result.h = NAN;
+    Result.I = proxy.integral();
+    Result.Error = proxy.maxError() * (proxy.upper() - proxy.lower());
+    // Samples are stored in decreasing x.
+    Result.X.assign(proxy.nodes().rbegin(), proxy.nodes().rend());
+    Result.FX.assign(proxy.values().rbegin(), proxy.values().rend());
+    return Result;
+}
+
+// G7-K15 on [-1, 1] (QUADPACK qk15): Kronrod nodes from the outside in, the
+// Gauss nodes being XGK[1], XGK[3], XGK[5] and the centre XGK[7].
+static const double XGK[8] = {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.000000000000000000000000000000000};
+static const double WGK[8] = {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714};
+static const double WG[4] = {
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327};
+
+namespace {
+
+struct Segment
+{
+    double A, B;
+    double I, E;
+    array<double, 15> FX; // f at the nodes, in increasing x
+
+    bool operator<(const Segment &o) const { return E < o.E; }
+};
+
+// The 15 nodes of [a, b] in increasing x.
+void kronrodNodes(double a, double b, double *x)
+{
+    const double c = 0.5 * (a + b), h = 0.5 * (b - a);
+    for (int j = 0; j < 7; ++j) {
+        x[j] = c - h * XGK[j];
+        x[14 - j] = c + h * XGK[j];
+    }
+    x[7] = c;
+}
+
+// Integral and error estimate of one segment from its 15 values.
+void kronrodRule(Segment &s)
+{
+    const double h = 0.5 * (s.B - s.A);
+    const double *f = s.FX.data();
+
+    double resK = WGK[7] * f[7], resG = WG[3] * f[7];
+    double resAbs = WGK[7] * fabs(f[7]);
+    for (int j = 0; j < 7; ++j) {
+        const double pair = f[j] + f[14 - j];
+        resK += WGK[j] * pair;
+        resAbs += WGK[j] * (fabs(f[j]) + fabs(f[14 - j]));
+        if (j % 2 == 1)
+            resG += WG[j / 2] * pair;
+    }
+
+    const double mean = 0.5 * resK;
+    double resAsc = WGK[7] * fabs(f[7] - mean);
+    for (int j = 0; j < 7; ++j)
+        resAsc += WGK[j] * (fabs(f[j] - mean) + fabs(f[14 - j] - mean));
+
+    s.I = resK * h;
+    resAbs *= fabs(h);
+    resAsc *= fabs(h);
+    double err = fabs((resK - resG) * h);
+    if (resAsc != 0 && err != 0)
+        err = resAsc * min(1.0, pow(200 * err / resAsc, 1.5));
+    const double eps = numeric_limits<double>::epsilon();
+    if (resAbs > numeric_limits<double>::min() / (50 * eps))
+        err = max(50 * eps * resAbs, err);
+
+    // A NaN or inf value goes to the top of the queue to be split first.
+    s.E = isfinite(err) ? err : numeric_limits<double>::infinity();
+}
+
+} // namespace
+
+IntegrationResult IntegrationMethods::gaussKronrod(const ExpressionHandle &f, double a, double b,
+                                                   double absTol, double relTol, int maxSubintervals)
+{
+    return gaussKronrod(f->function(), a, b, absTol, relTol, maxSubintervals);
+}
+
+IntegrationResult IntegrationMethods::gaussKronrod(const CompiledFunction &f, double a, double b,
+                                                   double absTol, double relTol, int maxSubintervals)
+{
+    IntegrationResult Result;
+    array<double, 30> x, fx;
+
+    Segment first;
+    first.A = a;
+    first.B = b;
+    kronrodNodes(a, b, x.data());
+    f.evalBatch(x.data(), first.FX.data(), 15);
+    Result.Evaluations = 15;
+    kronrodRule(first);
+
+    // Max-heap on the error estimate
+    vector<Segment> segments{first};
+    double I = first.I, E = first.E;
+
+    while (int(segments.size()) < maxSubintervals) {
+        // An infinite I (a node on a singularity) cannot set a relative target.
+        const double target = isfinite(I) ? max(absTol, relTol * fabs(I)) : absTol;
+        if (E <= target)
+            break;
+
+        const Segment worst = segments.front();
+        const double mid = 0.5 * (worst.A + worst.B);
+        if (!(mid > worst.A && mid < worst.B))
+            break; // at the resolution of double: cannot split further
+        pop_heap(segments.begin(), segments.end());
+        segments.pop_back();
+
+        // Both halves in one batch
+        Segment left, right;
+        left.A = worst.A;
+        left.B = mid;
+        right.A = mid;
+        right.B = worst.B;
+        kronrodNodes(left.A, left.B, x.data());
+        kronrodNodes(right.A, right.B, x.data() + 15);
+        f.evalBatch(x.data(), fx.data(), 30);
+        Result.Evaluations += 30;
+        copy(fx.begin(), fx.begin() + 15, left.FX.begin());
+        copy(fx.begin() + 15, fx.end(), right.FX.begin());
+        kronrodRule(left);
+        kronrodRule(right);
+
+        segments.push_back(left);
+        push_heap(segments.begin(), segments.end());
+        segments.push_back(right);
+        push_heap(segments.begin(), segments.end());
+
+        if (isfinite(worst.I) && isfinite(worst.E)) {
+            I += left.I + right.I - worst.I;
+            E += left.E + right.E - worst.E;
+        } else {
+            // inf - inf: sum again
+            I = E = 0;
+            for (const Segment &s : segments) {
+                I += s.I;
+                E += s.E;
+            }
+        }
+    }
+
+    // Re-add the final partition from scratch (the running sums drift),
+    // and list its nodes left to right.
+    sort(segments.begin(), segments.end(),
+         [](const Segment &l, const Segment &r) { return l.A < r.A; });
+
+    Result.I = 0;
+    Result.Error = 0;
+    Result.h = b - a;
+    Result.X.resize(15 * segments.size());
+    Result.FX.resize(15 * segments.size());
+    for (size_t k = 0; k < segments.size(); ++k) {
+        const Segment &s = segments[k];
+        Result.I += s.I;
+        Result.Error += s.E;
+        Result.h = min(Result.h, s.B - s.A);
+        kronrodNodes(s.A, s.B, Result.X.data() + 15 * k);
+        copy(s.FX.begin(), s.FX.end(), Result.FX.begin() + 15 * k);
+    }
+    return Result;
+}
+
+// Points per task in the multidimensional rules.
+static const size_t CubatureBlock = 4096;
+
+// body(i) for i < n: on the pool when f can be evaluated off the GUI
+// thread, else in order here.
+static void forBlocks(const CompiledFunction &f, size_t n, const std::function<void(size_t)> &body)
+{
+    if (n > 1 && f.isCompiled()) {
+        ThreadPool::instance().parallelFor(n, body);
+        return;
+    }
+    for (size_t i = 0; i < n; ++i)
+        body(i);
+}
+
+// Evaluate f on columns[0..d)[0..n) and return the pairwise sum of
+// weight[i] * f; out is scratch of n values.
+static double weightedBlockSum(const CompiledFunction &f, const vector<vector<double>> &columns,
+                               const double *weight, vector<double> &out, size_t n)
+{
+    vector<const double *> pointers(columns.size());
+    for (size_t v = 0; v < columns.size(); ++v)
+        pointers[v] = columns[v].data();
+    out.resize(n);
+    f.evalBatch(pointers.data(), out.data(), n);
+    if (weight)
+        for (size_t i = 0; i < n; ++i)
+            out[i] *= weight[i];
+    return pairwise(out.data(), n);
+}
+
+IntegrationResult IntegrationMethods::cubature(const ExpressionHandle &f, const IntegrationBox &box,
+                                               double absTol, double relTol, int maxOrder)
+{
+    return cubature(f->function(), box, absTol, relTol, maxOrder);
+}
+
+IntegrationResult IntegrationMethods::cubature(const CompiledFunction &f, const IntegrationBox &box,
+                                               double absTol, double relTol, int maxOrder)
+{
+    IntegrationResult Result;
+    Result.I = NAN;
+    Result.h = NAN;
+    const size_t d = box.size();
+    if (d == 0 || d != f.variables()) {
+        cerr << "Cubature needs one [lo, hi] per variable of f.\n";
+        return Result;
+    }
+
+    // Affine map of [-1, 1] onto each axis
+    vector<double> centre(d), half(d);
+    double volume = 1;
+    for (size_t v = 0; v < d; ++v) {
+        centre[v] = 0.5 * (box[v].first + box[v].second);
+        half[v] = 0.5 * (box[v].second - box[v].first);
+        volume *= half[v];
+    }
+
+    const long long maxPoints = 1 << 24;
+    double previous = NAN;
+    for (int order : {4, 8, 16, 32, 64}) {
+        long long points = 1;
+        for (size_t v = 0; v < d && points <= maxPoints; ++v)
+            points *= order;
+        if (order > maxOrder || points > maxPoints)
+            break;
+
+        const double *x = nullptr, *w = nullptr;
+        gaussLegendreTable(order, x, w);
+
+        // Point k has node digit_v(k) on axis v, digits in base `order`
+        // with axis 0 fastest.
+        const size_t blocks = (points + CubatureBlock - 1) / CubatureBlock;
+        vector<double> blockSum(blocks);
+        forBlocks(f, blocks, [&](size_t b) {
+            const long long first = (long long)b * CubatureBlock;
+            const size_t n = (size_t)min<long long>(CubatureBlock, points - first);
+            vector<vector<double>> columns(d, vector<double>(n));
+            vector<double> weight(n), out;
+            for (size_t i = 0; i < n; ++i) {
+                long long k = first + i;
+                double wk = 1;
+                for (size_t v = 0; v < d; ++v) {
+                    const int digit = int(k % order);
+                    k /= order;
+                    columns[v][i] = centre[v] + half[v] * x[digit];
+                    wk *= w[digit];
+                }
+                weight[i] = wk;
+            }
+            blockSum[b] = weightedBlockSum(f, columns, weight.data(), out, n);
+        });
+
+        Result.I = volume * pairwise(blockSum.data(), blocks);
+        Result.Evaluations += points;
+        Result.Error = isnan(previous) ? NAN : fabs(Result.I - previous);
+        Result.Levels.push_back({points, Result.I, Result.Error});
+        if (!isnan(previous) && Result.Error <= max(absTol, relTol * fabs(Result.I)))
+            break;
+        previous = Result.I;
+    }
+
+    if (Result.Levels.empty())
+        cerr << "Too many variables for a tensor-product rule; use quasi-Monte Carlo.\n";
+    return Result;
+}
+
+IntegrationResult IntegrationMethods::quasiMonteCarlo(const ExpressionHandle &f, const IntegrationBox &box,
+                                                      double absTol, double relTol, long long maxPoints,
+                                                      int randomizations, uint32_t seed)
+{
+    return quasiMonteCarlo(f->function(), box, absTol, relTol, maxPoints, randomizations, seed);
+}
+
+IntegrationResult IntegrationMethods::quasiMonteCarlo(const CompiledFunction &f, const IntegrationBox &box,
+                                                      double absTol, double relTol, long long maxPoints,
+                                                      int randomizations, uint32_t seed)
+{
+    IntegrationResult Result;
+    Result.I = NAN;
+    Result.h = NAN;
+    const size_t d = box.size();
+    if (d == 0 || d != f.variables()) {
+        cerr << "Quasi-Monte Carlo needs one [lo, hi] per variable of f.\n";
+        return Result;
+    }
+    if (d > SobolSequence::MaxDimensions) {
+        cerr << "Sobol points are available for up to " << SobolSequence::MaxDimensions << " variables.\n";
+        return Result;
+    }
+    if (randomizations < 2) {
+        cerr << "Quasi-Monte Carlo needs at least two randomizations for an error estimate.\n";
+        return Result;
+    }
+
+    double volume = 1;
+    for (const pair<double, double> &side : box)
+        volume *= side.second - side.first;
+
+    vector<SobolSequence> sequences;
+    for (int r = 0; r < randomizations; ++r)
+        sequences.emplace_back(unsigned(d), seed + uint32_t(r) * 0x9e3779b9u);
+
+    // Sums of f over each block of each randomization, in index order.
+    // Rounds double the points: [0, B), [B, 2B), [2B, 4B), ... so every
+    // round ends on a power of two, where the Sobol net is complete.
+    const long long cap = min<long long>(maxPoints, 1LL << 32);
+    vector<vector<double>> blockSum(randomizations);
+    vector<double> estimate(randomizations);
+    long long done = 0;
+    for (long long next = CubatureBlock; next <= cap; next *= 2) {
+        const size_t firstBlock = done / CubatureBlock;
+        const size_t blocks = (next - done) / CubatureBlock;
+        for (vector<double> &sums : blockSum)
+            sums.resize(firstBlock + blocks);
+
+        forBlocks(f, randomizations * blocks, [&](size_t task) {
+            const size_t r = task / blocks, b = firstBlock + task % blocks;
+            const SobolSequence &sobol = sequences[r];
+            vector<vector<double>> columns(d, vector<double>(CubatureBlock));
+            vector<double> out;
+            for (size_t i = 0; i < CubatureBlock; ++i) {
+                const uint32_t index = uint32_t(b * CubatureBlock + i);
+                for (size_t v = 0; v < d; ++v)
+                    columns[v][i] = box[v].first + (box[v].second - box[v].first) * sobol.point(index, unsigned(v));
+            }
+            blockSum[r][b] = weightedBlockSum(f, columns, nullptr, out, CubatureBlock);
+        });
+        Result.Evaluations += randomizations * (next - done);
+        done = next;
+
+        // Mean and standard error over the randomizations
+        double mean = 0;
+        for (int r = 0; r < randomizations; ++r) {
+            estimate[r] = volume * pairwise(blockSum[r].data(), blockSum[r].size()) / done;
+            mean += estimate[r];
+        }
+        mean /= randomizations;
+        double variance = 0;
+        for (int r = 0; r < randomizations; ++r)
+            variance += (estimate[r] - mean) * (estimate[r] - mean);
+        variance /= randomizations - 1;
+
+        Result.I = mean;
+        Result.Error = sqrt(variance / randomizations);
+        Result.Levels.push_back({done, Result.I, Result.Error});
+        if (Result.Error <= max(absTol, relTol * fabs(Result.I)))
+            break;
+    }
+    return Result;
+}
+
+SampleIntegrator::SampleIntegrator(NewtonCotes rule, const std::function<void(double, double)> &cumulative)
+    : Rule(rule), Sink(cumulative)
+{
+}
+
+// Neumaier's compensated addition, as in streaming()
+void SampleIntegrator::add(double v)
+{
+    const double t = Sum + v;
+    if (fabs(Sum) >= fabs(v))
+        C += (Sum - t) + v;
+    else
+        C += (v - t) + Sum;
+    Sum = t;
+}
+
+// Integral over [x1, x2] of the quadratic through (x0, y0), (x1, y1), (x2, y2)
+static double secondHalf(double x0, double y0, double x1, double y1, double x2, double y2)
+{
+    const double h0 = x1 - x0, h1 = x2 - x1, H = h0 + h1;
+    return h1 / 6 * ((3 - h1 / H) * y2 + (3 + h1 / h0) * y1 - h1 * h1 / (H * h0) * y0);
+}
+
+void SampleIntegrator::push(double x, double y)
+{
+    if (Count == 0) {
+        AX = x;
+        AY = y;
+        ++Count;
+        if (Sink)
+            Sink(x, 0);
+        return;
+    }
+    const double lastX = HaveMiddle ? MX : AX;
+    if (!(x > lastX))
+        Sorted = false;
+    ++Count;
+
+    if (Rule != NewtonCotes::SimpsonOneThird) {
+        add((x - AX) * (AY + y) / 2);
+        AX = x;
+        AY = y;
+        if (Sink)
+            Sink(x, total());
+        return;
+    }
+
+    if (!HaveMiddle) {
+        MX = x;
+        MY = y;
+        HaveMiddle = true;
+        return;
+    }
+
+    // Pair A, M, B: the quadratic over [A, M] (read backwards from B),
+    // then over [M, B]
+    const double first = -secondHalf(x, y, MX, MY, AX, AY);
+    const double second = secondHalf(AX, AY, MX, MY, x, y);
+    if (Sink)
+        Sink(MX, total() + first);
+    add(first);
+    add(second);
+    if (Sink)
+        Sink(x, total());
+
+    PX = MX;
+    PY = MY;
+    HavePrevious = true;
+    AX = x;
+    AY = y;
+    HaveMiddle = false;
+}
+
+IntegrationResult SampleIntegrator::finish()
+{
+    IntegrationResult Result;
+    Result.h = NAN;
+    Result.I = NAN;
+    Result.Evaluations = Count;
+
+    if (Rule == NewtonCotes::SimpsonThreeEighth) {
+        cerr << "Simpson's 3/8 rule has no form for uneven samples; use 1/3 or trapezoidal.\n";
+        return Result;
+    }
+    if (Count < 2) {
+        cerr << "Integrating samples needs at least two of them.\n";
+        return Result;
+    }
+    if (!Sorted) {
+        cerr << "Sample x values must be strictly increasing.\n";
+        return Result;
+    }
+
+    if (HaveMiddle) {
+        // Odd last interval [A, M]: quadratic through the last three
+        // samples, or a trapezoid when there are only two.
+        const double last = HavePrevious ? secondHalf(PX, PY, AX, AY, MX, MY) : (MX - AX) * (AY + MY) / 2;
+        add(last);
+        if (Sink)
+            Sink(MX, total());
+        AX = MX;
+        AY = MY;
+        HaveMiddle = false;
+    }
+    Result.I = total();
+    return Result;
+}
+
+// Samples per panel in the parallel sample rules: an even number of
+// intervals, so Simpson's pairs never straddle two panels.
+static const size_t SamplePanel = 32766;
+
+static IntegrationResult integrateSamples(const SampleView &samples, NewtonCotes rule, double *cumulative)
+{
+    const size_t n = samples.Size;
+    if (n < 2)
+        return SampleIntegrator(rule).finish();
+
+    // Panel p covers intervals [p * SamplePanel, (p + 1) * SamplePanel);
+    // the last one also takes the remainder, so it never holds a lone
+    // interval that Simpson's rule could not pair.
+    const size_t intervals = n - 1;
+    const size_t panels = max<size_t>(1, intervals / SamplePanel);
+    vector<double> panelSum(panels);
+    vector<char> failed(panels, 0);
+
+    ThreadPool::instance().parallelFor(panels, [&](size_t p) {
+        const size_t first = p * SamplePanel;
+        const size_t last = p + 1 == panels ? intervals : first + SamplePanel; // sample index
+        size_t i = first;
+        std::function<void(double, double)> sink;
+        if (cumulative)
+            sink = [&](double, double c) {
+                // The first sample of a later panel is the previous panel's last.
+                if (i > first || p == 0)
+                    cumulative[i] = c;
+                ++i;
+            };
+        SampleIntegrator panel(rule, sink);
+        for (size_t k = first; k <= last; ++k)
+            panel.push(samples.x(k), samples.y(k));
+        panelSum[p] = panel.finish().I;
+        failed[p] = isnan(panelSum[p]);
+    });
+
+    IntegrationResult Result;
+    Result.h = NAN;
+    Result.Evaluations = n;
+    Result.I = find(failed.begin(), failed.end(), 1) != failed.end() ? NAN : pairwise(panelSum.data(), panels);
+
+    // Shift each panel's running integral by the panels before it.
+    if (cumulative && panels > 1) {
+        vector<double> offset(panels, 0);
+        for (size_t p = 1; p < panels; ++p)
+            offset[p] = offset[p - 1] + panelSum[p - 1];
+        ThreadPool::instance().parallelFor(panels - 1, [&](size_t q) {
+            const size_t p = q + 1;
+            const size_t first = p * SamplePanel + 1, last = p + 1 == panels ? intervals : first - 1 + SamplePanel;
+            for (size_t i = first; i <= last; ++i)
+                cumulative[i] += offset[p];
+        });
+    }
+    return Result;
+}
+
+IntegrationResult IntegrationMethods::trapezoidal(const SampleView &samples, double *cumulative)
+{
+    return integrateSamples(samples, NewtonCotes::Trapezoidal, cumulative);
+}
+
+IntegrationResult IntegrationMethods::simpsonOneThird(const SampleView &samples, double *cumulative)
+{
+    return integrateSamples(samples, NewtonCotes::SimpsonOneThird, cumulative);
+}
+
+IntegrationResult IntegrationMethods::integrateFile(const string &path, SampleFormat format, NewtonCotes rule,
+                                                    const std::function<void(double, double)> &cumulative)
+{
+    const MappedFile file(path);
+    if (!file.isOpen()) {
+        cerr << file.error() << "\n";
+        IntegrationResult Result;
+        Result.h = NAN;
+        Result.I = NAN;
+        return Result;
+    }
+
+    if (format == SampleFormat::Binary && !cumulative)
+        return integrateSamples(binarySamples(file), rule, nullptr);
+
+    SampleIntegrator integrator(rule, cumulative);
+    if (format == SampleFormat::Binary) {
+        const SampleView samples = binarySamples(file);
+        for (size_t i = 0; i < samples.Size; ++i)
+            integrator.push(samples.x(i), samples.y(i));
+    } else {
+        readCsvSamples(file, [&](double x, double y) { integrator.push(x, y); });
+    }
+    return integrator.finish();
+}
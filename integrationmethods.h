@@ -1,17 +1,97 @@
 #ifndef INTEGRATIONMETHODS_H
 #define INTEGRATIONMETHODS_H
 
+#include <cmath>
+#include <cstdint>
 #include <ginac/ginac.h>
+#include <utility>
+
+#include "chebyshev.h"
+#include "compiledfunction.h"
+#include "expressionregistry.h"
+#include "sampledata.h"
+#include "threadpool.h"
 
 using namespace std;
 using namespace GiNaC;
 
+/** Estimate after one refinement of a multidimensional rule. */
+struct CubatureLevel
+{
+    long long Points;   // points in the rule (QMC: per randomization)
+    double I;
+    double Error;
+};
+
 struct IntegrationResult
 {
     vector<double> X;
     vector<double> FX;
     double h;
     double I;
+    double Error = NAN;   // estimated |I - integral|; NaN when the rule gives none
+    long long Evaluations = 0; // calls of f
+    vector<vector<double>> Tableau; // Romberg only: Tableau[k][j], j <= k
+    vector<CubatureLevel> Levels;   // cubature and quasi-Monte Carlo only
+};
+
+/** Axis-aligned box: one [lo, hi] per variable of f, in f's variable order. */
+typedef vector<pair<double, double>> IntegrationBox;
+
+/** Composite rules available in streaming mode. */
+enum class NewtonCotes { Trapezoidal, SimpsonOneThird, SimpsonThreeEighth };
+
+/** How streaming mode adds up the weighted f values. */
+enum class Summation { Neumaier, Pairwise };
+
+/**
+ * Integral of samples (x_i, y_i) pushed in strictly increasing x, in O(1)
+ * memory, for data too large to hold. Trapezoidal sums (x_{i+1} - x_i) *
+ * (y_i + y_{i+1}) / 2; SimpsonOneThird integrates the quadratic through
+ * each pair of intervals, weighted for uneven spacing, and an odd last
+ * interval by the quadratic through the last three samples. The running
+ * sum is compensated (Neumaier).
+ *
+ * With a cumulative sink, sink(x_i, integral from x_0 to x_i) is called
+ * once per sample in order; Simpson reports a pair's middle sample when
+ * the pair is complete.
+ */
+class SampleIntegrator
+{
+public:
+    explicit SampleIntegrator(NewtonCotes rule, const std::function<void(double, double)> &cumulative = nullptr);
+
+    void push(double x, double y);
+
+    /**
+     * Close the last interval.
+     * @return  I over all samples, Evaluations = sample count; I is NaN
+     *          (with a message on cerr) for unsorted x, fewer than two
+     *          samples, or a rule without an uneven form
+     */
+    IntegrationResult finish();
+
+private:
+    void add(double v);
+    double total() const { return Sum + C; }
+
+    NewtonCotes Rule;
+    std::function<void(double, double)> Sink;
+    double Sum = 0, C = 0;
+    long long Count = 0;
+    bool Sorted = true;
+
+    // Last sample (Simpson: start of the open pair), the open pair's middle
+    // sample, and the middle of the pair before, for an odd last interval.
+    double AX = 0, AY = 0, MX = 0, MY = 0, PX = 0, PY = 0;
+    bool HaveMiddle = false, HavePrevious = false;
+};
+
+struct ScalingPoint
+{
+    unsigned Threads;
+    double Seconds;
+    double I;
 };
 
 class IntegrationMethods
@@ -29,6 +109,8 @@ public:
      * @return        IntegrationResult with nodes, values, stepSize, integral
      */
     IntegrationResult trapezoidal(const ex &fx, symbol x, double a, double b, int n);
+    IntegrationResult trapezoidal(const CompiledFunction &f, double a, double b, int n);
+    IntegrationResult trapezoidal(const ExpressionHandle &f, double a, double b, int n);
 
     /**
      * Compute integral using Simpson's 1/3 rule (n must be even):
@@ -42,6 +124,8 @@ public:
      * @return        IntegrationResult with nodes, values, stepSize, integral
      */
     IntegrationResult simpsonOneThird(const ex &f_expr, symbol x, double a, double b, int n);
+    IntegrationResult simpsonOneThird(const CompiledFunction &f, double a, double b, int n);
+    IntegrationResult simpsonOneThird(const ExpressionHandle &f, double a, double b, int n);
 
     /**
      * Compute integral using Simpson's 3/8 rule (n mod 3 == 0):
@@ -55,6 +139,194 @@ public:
      * @return        IntegrationResult with nodes, values, stepSize, integral
      */
     IntegrationResult simpsonThreeEighth(const ex &f_expr, symbol x, double a, double b, int n);
+    IntegrationResult simpsonThreeEighth(const CompiledFunction &f, double a, double b, int n);
+    IntegrationResult simpsonThreeEighth(const ExpressionHandle &f, double a, double b, int n);
+
+    /**
+     * The composite rules without the node table: nodes are generated,
+     * evaluated and summed block by block, so n can go far past what X/FX
+     * could hold. Same nodes and weights as trapezoidal(), simpsonOneThird()
+     * and simpsonThreeEighth(), with the same parity requirements on n.
+     *
+     * The nodes are cut into fixed panels of whole Simpson groups (a
+     * multiple of 6 intervals, so both the 1/3 parity and the 3/8 mod-3
+     * pattern line up), which the pool sums in parallel; the panel sums
+     * are then added in a fixed pairwise tree. Panels do not depend on the
+     * thread count, so neither does the result, to the last bit. Memory is
+     * one double per panel.
+     *
+     * @param sum      Neumaier-compensated or pairwise summation in a panel
+     * @param samples  If nonzero, X/FX keep about this many evenly spaced
+     *                 nodes for display; otherwise they stay empty
+     */
+    IntegrationResult streaming(const CompiledFunction &f, double a, double b, long long n,
+                                NewtonCotes rule, Summation sum = Summation::Neumaier,
+                                size_t samples = 0, ThreadPool &pool = ThreadPool::instance());
+    IntegrationResult streaming(const ExpressionHandle &f, double a, double b, long long n,
+                                NewtonCotes rule, Summation sum = Summation::Neumaier,
+                                size_t samples = 0);
+
+    /**
+     * Time streaming() on pools of 1, 2, ..., maxThreads threads.
+     *
+     * @return  One entry per thread count; I is the same in every entry
+     */
+    static vector<ScalingPoint> streamingScaling(const CompiledFunction &f, double a, double b,
+                                                 long long n, NewtonCotes rule, unsigned maxThreads);
+
+    /**
+     * Romberg integration: trapezoid sums on n, 2n, 4n, ... intervals with
+     * Richardson extrapolation,
+     * R[k][j] = R[k][j-1] + (R[k][j-1] - R[k-1][j-1]) / (4^j - 1).
+     *
+     * Each level evaluates only the new midpoints and halves the previous
+     * trapezoid sum, so reaching level k costs n * 2^k + 1 evaluations,
+     * about half of rerunning trapezoidal() at every level. Stops once two
+     * successive diagonal entries agree within max(absTol, relTol * |I|).
+     * The finer grids are never stored: each level's midpoints are summed
+     * in blocks, so memory is O(n) whatever the level.
+     *
+     * @param n          Intervals of the first trapezoid sum
+     * @param maxLevels  Refinements after the first sum
+     * @return           I = last diagonal entry, Error = its change from
+     *                   the previous one, the tableau, h of the finest
+     *                   level, and the starting grid in X/FX
+     */
+    IntegrationResult romberg(const CompiledFunction &f, double a, double b, int n,
+                              double absTol, double relTol, int maxLevels = 16);
+    IntegrationResult romberg(const ExpressionHandle &f, double a, double b, int n,
+                              double absTol, double relTol, int maxLevels = 16);
+
+    /**
+     * Composite Gauss–Legendre: `order` nodes (from the constexpr tables
+     * in gausslegendre.h) in each of `panels` equal panels, all evaluated
+     * in one batch. Exact for polynomials of degree 2 * order - 1 per panel.
+     *
+     * @param order  One of gaussLegendreOrders (2, 3, 4, 5, 6, 8, 10, 12,
+     *               16, 20, 32, 64); anything else gives I = NaN
+     * @return       Nodes and values in X/FX, panel width in h
+     */
+    IntegrationResult gaussLegendre(const CompiledFunction &f, double a, double b, int panels, int order);
+    IntegrationResult gaussLegendre(const ExpressionHandle &f, double a, double b, int panels, int order);
+
+    /**
+     * Double-exponential (tanh-sinh) quadrature: x = tanh(pi/2 sinh t)
+     * crowds the nodes doubly exponentially towards a and b, so endpoint
+     * singularities such as 1/sqrt(x) or log(x) converge as fast as
+     * smooth integrands. The step in t is halved, reusing every previous
+     * node, until two levels agree within max(absTol, relTol * |I|).
+     * f is never evaluated at a or b themselves. Nodes next to an end
+     * far from 0 are rounded in x, which limits a singularity there (such
+     * as 1/sqrt(1 - x) at 1) to about 8 digits; the levels stop once
+     * their differences no longer shrink.
+     *
+     * @return  Error = change over the last level; nodes in X/FX
+     */
+    IntegrationResult tanhSinh(const CompiledFunction &f, double a, double b,
+                               double absTol, double relTol, int maxLevels = 10);
+    IntegrationResult tanhSinh(const ExpressionHandle &f, double a, double b,
+                               double absTol, double relTol, int maxLevels = 10);
+
+    /**
+     * Clenshaw–Curtis through a Chebyshev proxy: f is sampled at
+     * Chebyshev–Lobatto points, doubling until the coefficients decay
+     * below tol (see ChebyshevProxy), and the series is integrated term by
+     * term. Converges geometrically for analytic f.
+     *
+     * @param tol  Coefficient cutoff relative to max|f|; 0 for machine precision
+     * @return     Error = proxy max error * (b - a), an estimate rather than
+     *             a bound; the samples in X/FX; h = NaN
+     */
+    IntegrationResult clenshawCurtis(const CompiledFunction &f, double a, double b,
+                                     double tol = 0, size_t maxDegree = 1 << 16);
+    IntegrationResult clenshawCurtis(const ExpressionHandle &f, double a, double b,
+                                     double tol = 0, size_t maxDegree = 1 << 16);
+    /** The integral of an existing proxy over its interval; no calls of f. */
+    IntegrationResult clenshawCurtis(const ChebyshevProxy &proxy);
+
+    /**
+     * Adaptive Gauss–Kronrod (G7-K15) quadrature.
+     *
+     * Each subinterval gets the 15-point Kronrod estimate and, from the
+     * embedded 7-point Gauss rule, an error estimate (QUADPACK scaling).
+     * Subintervals wait in a priority queue by error; the worst one is
+     * halved until the total error is below max(absTol, relTol * |I|), so
+     * evaluations go where f is hard rather than spread evenly.
+     *
+     * @param absTol           Absolute error target
+     * @param relTol           Relative error target
+     * @param maxSubintervals  Cap on the partition size
+     * @return                 Integral, error estimate and evaluation count;
+     *                         X/FX are the nodes of the final partition and
+     *                         h the width of its narrowest subinterval
+     */
+    IntegrationResult gaussKronrod(const CompiledFunction &f, double a, double b,
+                                   double absTol, double relTol, int maxSubintervals = 2000);
+    IntegrationResult gaussKronrod(const ExpressionHandle &f, double a, double b,
+                                   double absTol, double relTol, int maxSubintervals = 2000);
+
+    /**
+     * Trapezoidal rule on tabulated samples with any (increasing) spacing.
+     * Fixed panels are summed in parallel, as in streaming(), so the result
+     * does not depend on the thread count. See SampleIntegrator.
+     *
+     * @param samples     Viewed in place, e.g. from binarySamples()
+     * @param cumulative  If given, receives the integral from x_0 to x_i for
+     *                    every i (samples.Size values)
+     * @return            I and Evaluations (= samples); no X/FX table
+     */
+    IntegrationResult trapezoidal(const SampleView &samples, double *cumulative = nullptr);
+
+    /** Simpson's 1/3 rule for uneven spacing on tabulated samples; as trapezoidal(SampleView). */
+    IntegrationResult simpsonOneThird(const SampleView &samples, double *cumulative = nullptr);
+
+    /**
+     * Integrate a CSV or binary sample file through a memory map, without
+     * loading it into vectors. CSV rows are parsed and integrated as they
+     * are read; binary pairs are used in place (in parallel when no
+     * cumulative output is wanted).
+     *
+     * @param rule        Trapezoidal or SimpsonOneThird
+     * @param cumulative  If given, called as for SampleIntegrator
+     */
+    IntegrationResult integrateFile(const string &path, SampleFormat format, NewtonCotes rule,
+                                    const std::function<void(double, double)> &cumulative = nullptr);
+
+    /**
+     * Tensor-product Gauss–Legendre cubature over a box, for f of a few
+     * variables (e.g. parsed with {"x", "y", "z"}). The order per axis runs
+     * through 4, 8, 16, 32, 64 until two orders agree within
+     * max(absTol, relTol * |I|), or order^d would pass 2^24 points.
+     * Points are evaluated in parallel blocks and summed in a fixed order.
+     *
+     * @param box  One [lo, hi] per variable of f
+     * @return     I, Error (change over the last order), Levels per order;
+     *             I = NaN when box does not match f
+     */
+    IntegrationResult cubature(const CompiledFunction &f, const IntegrationBox &box,
+                               double absTol, double relTol, int maxOrder = 64);
+    IntegrationResult cubature(const ExpressionHandle &f, const IntegrationBox &box,
+                               double absTol, double relTol, int maxOrder = 64);
+
+    /**
+     * Randomized quasi-Monte Carlo with Owen-scrambled Sobol points (sobol.h),
+     * for up to SobolSequence::MaxDimensions variables. `randomizations`
+     * independent scramblings are run side by side, each doubling its point
+     * count per round; their spread gives the standard error, and the rounds
+     * stop once it is within max(absTol, relTol * |I|). Blocks of points are
+     * generated and evaluated in parallel; the result does not depend on the
+     * thread count.
+     *
+     * @param maxPoints  Cap on points per randomization
+     * @return           I (mean over randomizations), Error (standard error),
+     *                   Levels per round
+     */
+    IntegrationResult quasiMonteCarlo(const CompiledFunction &f, const IntegrationBox &box,
+                                      double absTol, double relTol, long long maxPoints = 1 << 22,
+                                      int randomizations = 8, uint32_t seed = 0);
+    IntegrationResult quasiMonteCarlo(const ExpressionHandle &f, const IntegrationBox &box,
+                                      double absTol, double relTol, long long maxPoints = 1 << 22,
+                                      int randomizations = 8, uint32_t seed = 0);
 };
 
 #endif // INTEGRATIONMETHODS_H
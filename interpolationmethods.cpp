@@ -1,84 +1,389 @@
 #include "interpolationmethods.h"
 
-InterpolationResult InterpolationMethods::lagrange(const vector<double> &x, const std::vector<double> &y, const double &x_, const symbol &sym)
+#include <algorithm>
+#include <iostream>
+
+BarycentricLagrange::BarycentricLagrange(const vector<double> &x, const vector<double> &y)
+    : X(x), Y(y), W(x.size(), 1.0)
 {
-    InterpolationResult History;
-    for (int n = 0; n < x.size(); ++n) {
-        ex l_n = 1;
-        for (int m = 0; m < x.size(); ++m) {
-            if(n == m) continue;
-            l_n *= (sym - x[m]) / (x[n] - x[m]);
+    const size_t n = X.size();
+    if (n == 0 || Y.size() != n) {
+        cerr << "Barycentric interpolation needs as many y values as x values.\n";
+        return;
+    }
+
+    // The weights only matter up to a common factor; measuring distances
+    // in units of a quarter of the node span keeps the products from
+    // overflowing or underflowing for large n.
+    const auto [lo, hi] = minmax_element(X.begin(), X.end());
+    const double scale = *hi > *lo ? 4 / (*hi - *lo) : 1;
+    for (size_t j = 0; j < n; ++j) {
+        for (size_t k = 0; k < n; ++k) {
+            if (k != j)
+                W[j] *= (X[j] - X[k]) * scale;
         }
-        double l_nx = ex_to<numeric>(l_n.subs(sym == x_)).to_double();
-        History.L.push_back(make_pair(l_n, l_nx));
+        if (W[j] == 0) {
+            cerr << "Interpolation nodes must be distinct.\n";
+            return;
+        }
+        W[j] = 1 / W[j];
     }
+    Valid = true;
+}
 
-    ex P_ex;
-    for (int n = 0; n < y.size(); ++n) {
-        P_ex += History.L[n].first * y[n];
+double BarycentricLagrange::operator()(double t) const
+{
+    double out;
+    evalBatch(&t, &out, 1);
+    return out;
+}
+
+void BarycentricLagrange::evalBatch(const double *t, double *out, size_t n) const
+{
+    if (!Valid) {
+        fill(out, out + n, NAN);
+        return;
     }
 
-    double P_v = ex_to<numeric>(P_ex.subs(sym == x_)).to_double();
+    const size_t Block = 256;
+    double num[Block], den[Block];
+    long long hit[Block]; // node equal to the query, or -1
+    for (size_t i0 = 0; i0 < n; i0 += Block) {
+        const size_t m = min(Block, n - i0);
+        const double *tb = t + i0;
+        fill(num, num + m, 0.0);
+        fill(den, den + m, 0.0);
+        fill(hit, hit + m, -1);
+
+        for (size_t j = 0; j < X.size(); ++j) {
+            const double xj = X[j], wj = W[j], yj = Y[j];
+            for (size_t i = 0; i < m; ++i) {
+                const double d = tb[i] - xj;
+                const double c = wj / d;
+                num[i] += c * yj;
+                den[i] += c;
+                hit[i] = d == 0 ? (long long)j : hit[i];
+            }
+        }
+        for (size_t i = 0; i < m; ++i)
+            out[i0 + i] = hit[i] >= 0 ? Y[hit[i]] : num[i] / den[i];
+    }
+}
+
+void BarycentricLagrange::basis(double t, double *l) const
+{
+    const size_t n = X.size();
+    if (!Valid) {
+        fill(l, l + n, NAN);
+        return;
+    }
+    // l_j(t) = (w_j / (t - x_j)) / sum_k w_k / (t - x_k)
+    double den = 0;
+    for (size_t j = 0; j < n; ++j) {
+        if (t == X[j]) {
+            fill(l, l + n, 0.0);
+            l[j] = 1;
+            return;
+        }
+        l[j] = W[j] / (t - X[j]);
+        den += l[j];
+    }
+    for (size_t j = 0; j < n; ++j)
+        l[j] /= den;
+}
+
+ex BarycentricLagrange::basisPolynomial(size_t j, const symbol &sym) const
+{
+    ex l_n = 1;
+    for (size_t m = 0; m < X.size(); ++m) {
+        if (j == m) continue;
+        l_n *= (sym - X[m]) / (X[j] - X[m]);
+    }
+    return l_n;
+}
+
+ex BarycentricLagrange::polynomial(const symbol &sym) const
+{
+    ex P_ex;
+    for (size_t n = 0; n < Y.size(); ++n)
+        P_ex += basisPolynomial(n, sym) * Y[n];
+    return P_ex;
+}
+
+InterpolationResult InterpolationMethods::lagrange(const vector<double> &x, const std::vector<double> &y, const double &x_, const symbol &sym,
+                                                   bool symbolic)
+{
+    InterpolationResult History;
+    auto interpolant = make_shared<BarycentricLagrange>(x, y);
 
-    History.P = make_pair(P_ex, P_v);
+    vector<double> l(x.size());
+    interpolant->basis(x_, l.data());
+    for (size_t n = 0; n < x.size(); ++n)
+        History.L.push_back(make_pair(symbolic ? interpolant->basisPolynomial(n, sym) : ex(), l[n]));
 
+    History.P = make_pair(symbolic ? interpolant->polynomial(sym) : ex(), (*interpolant)(x_));
     History.D = {};
+    History.Barycentric = interpolant;
 
     return History;
 }
 
-InterpolationResult InterpolationMethods::newtonForward(const vector<double> &x, const std::vector<double> &y, const double &x_, const symbol &sym)
+DividedDifferences::DividedDifferences(const vector<double> &x, const vector<double> &y)
 {
-    InterpolationResult History = NewtonTable(x,y);
+    X.reserve(x.size());
+    T.reserve(row(x.size()));
+    for (size_t i = 0; i < x.size() && i < y.size(); ++i)
+        append(x[i], y[i]);
+}
 
-    ex P_ex = 0;
-    for (int term = 0; term < History.D.size(); ++term) {
-        ex temp = 1;
+bool DividedDifferences::append(double x, double y)
+{
+    const size_t n = X.size();
+    for (double xi : X) {
+        if (xi == x) {
+            cerr << "Interpolation nodes must be distinct.\n";
+            return false;
+        }
+    }
+
+    // New row n from row n - 1:
+    // f[x_{n-k}..x_n] = (f[x_{n-k+1}..x_n] - f[x_{n-k}..x_{n-1}]) / (x_n - x_{n-k})
+    T.resize(row(n + 1));
+    double *next = T.data() + row(n);
+    const double *prev = n ? T.data() + row(n - 1) : nullptr;
+    next[0] = y;
+    for (size_t k = 1; k <= n; ++k)
+        next[k] = (next[k - 1] - prev[k - 1]) / (x - X[n - k]);
+    X.push_back(x);
+    return true;
+}
+
+double DividedDifferences::forward(double t) const
+{
+    const size_t n = X.size();
+    if (n == 0)
+        return NAN;
+    // Coefficient k is f[x_0..x_k], the last entry of row k.
+    double p = T[row(n - 1) + n - 1];
+    for (size_t k = n - 1; k-- > 0;)
+        p = T[row(k) + k] + (t - X[k]) * p;
+    return p;
+}
+
+double DividedDifferences::backward(double t) const
+{
+    const size_t n = X.size();
+    if (n == 0)
+        return NAN;
+    // Coefficient k is f[x_{n-1-k}..x_{n-1}]: the whole last row, in order.
+    const double *c = T.data() + row(n - 1);
+    double p = c[n - 1];
+    for (size_t k = n - 1; k-- > 0;)
+        p = c[k] + (t - X[n - 1 - k]) * p;
+    return p;
+}
+
+NewtonPolynomial DividedDifferences::forwardForm() const
+{
+    const size_t n = X.size();
+    vector<double> c(n);
+    for (size_t k = 0; k < n; ++k)
+        c[k] = T[row(k) + k];
+    return NewtonPolynomial(vector<double>(X.begin(), X.end() - (n ? 1 : 0)), move(c));
+}
+
+NewtonPolynomial DividedDifferences::backwardForm() const
+{
+    const size_t n = X.size();
+    if (n == 0)
+        return {};
+    vector<double> z(X.rbegin(), X.rend() - 1);
+    return NewtonPolynomial(move(z), vector<double>(T.begin() + row(n - 1), T.end()));
+}
+
+ex DividedDifferences::forwardPolynomial(const symbol &sym) const
+{
+    return forwardForm().polynomial(sym);
+}
 
-        for (int i = 0; i < term; ++i) {
-            temp *= (sym - x[i]);
+ex DividedDifferences::backwardPolynomial(const symbol &sym) const
+{
+    return backwardForm().polynomial(sym);
+}
+
+NewtonPolynomial::NewtonPolynomial(vector<double> centers, vector<double> coefficients)
+    : Z(move(centers)), C(move(coefficients))
+{
+    Z.resize(C.empty() ? 0 : C.size() - 1);
+}
+
+double NewtonPolynomial::operator()(double t) const
+{
+    if (C.empty())
+        return NAN;
+    double p = C.back();
+    for (size_t k = C.size() - 1; k-- > 0;)
+        p = C[k] + (t - Z[k]) * p;
+    return p;
+}
+
+void NewtonPolynomial::evalBatch(const double *t, double *out, size_t n) const
+{
+    if (C.empty()) {
+        fill(out, out + n, NAN);
+        return;
+    }
+
+    const size_t Block = 256;
+    double p[Block];
+    for (size_t i0 = 0; i0 < n; i0 += Block) {
+        const size_t m = min(Block, n - i0);
+        const double *tb = t + i0;
+        fill(p, p + m, C.back());
+        for (size_t k = C.size() - 1; k-- > 0;) {
+            const double ck = C[k], zk = Z[k];
+            for (size_t i = 0; i < m; ++i)
+                p[i] = ck + (tb[i] - zk) * p[i];
         }
-        P_ex += numeric(History.D[term].front()) * temp;
+        copy(p, p + m, out + i0);
     }
+}
 
-    double P_v = ex_to<numeric>(P_ex.subs(sym == x_)).to_double();
+vector<double> NewtonPolynomial::powerCoefficients() const
+{
+    // Unroll the nesting from the inside: a <- c_k + (t - z_k) a.
+    vector<double> a;
+    if (C.empty())
+        return a;
+    a.reserve(C.size());
+    a.push_back(C.back());
+    for (size_t k = C.size() - 1; k-- > 0;) {
+        a.push_back(0);
+        for (size_t j = a.size() - 1; j > 0; --j)
+            a[j] = a[j - 1] - Z[k] * a[j];
+        a[0] = C[k] - Z[k] * a[0];
+    }
+    return a;
+}
 
-    History.P = make_pair(P_ex, P_v);
+ex NewtonPolynomial::polynomial(const symbol &sym) const
+{
+    const vector<double> a = powerCoefficients();
+    ex P_ex = 0;
+    for (size_t k = 0; k < a.size(); ++k)
+        P_ex += numeric(a[k]) * pow(sym, static_cast<int>(k));
+    return P_ex;
+}
+
+InterpolationResult InterpolationMethods::newtonForward(const vector<double> &x, const std::vector<double> &y, const double &x_, const symbol &sym,
+                                                        bool symbolic)
+{
+    auto table = make_shared<DividedDifferences>(x, y);
+    InterpolationResult History = symbolic ? NewtonTable(*table) : InterpolationResult();
+
+    auto polynomial = make_shared<NewtonPolynomial>(table->forwardForm());
+    History.P = make_pair(symbolic ? polynomial->polynomial(sym) : ex(), table->forward(x_));
     History.L = {};
+    History.Differences = table;
+    History.Polynomial = polynomial;
 
     return History;
 }
 
-InterpolationResult InterpolationMethods::newtonBackward(const vector<double> &x, const std::vector<double> &y, const double &x_, const symbol &sym)
+InterpolationResult InterpolationMethods::newtonBackward(const vector<double> &x, const std::vector<double> &y, const double &x_, const symbol &sym,
+                                                         bool symbolic)
 {
-    InterpolationResult History = NewtonTable(x,y);
-    ex P_ex;
-    for (int term = 0; term < History.D.size(); ++term) {
-        ex temp = 1;
+    auto table = make_shared<DividedDifferences>(x, y);
+    InterpolationResult History = symbolic ? NewtonTable(*table) : InterpolationResult();
 
-        for (int i = 0; i < term; ++i) {
-            temp *= (sym - x[x.size()-1-i]);
-        }
-        P_ex += numeric(History.D[term].back()) * temp;
+    auto polynomial = make_shared<NewtonPolynomial>(table->backwardForm());
+    History.P = make_pair(symbolic ? polynomial->polynomial(sym) : ex(), table->backward(x_));
+    History.Differences = table;
+    History.Polynomial = polynomial;
+
+    return History;
+}
+
+InterpolationResult InterpolationMethods::spline(const vector<double> &x, const std::vector<double> &y, const double &x_, const symbol &sym,
+                                                 SplineBoundary boundary, bool symbolic, double startSlope, double endSlope)
+{
+    InterpolationResult History;
+
+    // Sort the points by x; the table may list them in any order.
+    vector<size_t> order(min(x.size(), y.size()));
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    sort(order.begin(), order.end(), [&](size_t i, size_t j) { return x[i] < x[j]; });
+    vector<double> xs(order.size()), ys(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        xs[i] = x[order[i]];
+        ys[i] = y[order[i]];
     }
 
-    double P_v = ex_to<numeric>(P_ex.subs(sym == x_)).to_double();
+    auto interpolant = make_shared<CubicSpline>(xs, ys, boundary, startSlope, endSlope);
+    const double value = (*interpolant)(x_);
+    History.P = make_pair(symbolic && interpolant->valid() ? interpolant->piecePolynomial(interpolant->locate(x_), sym) : ex(),
+                          value);
+    History.Spline = interpolant;
+    return History;
+}
+
+static vector<double> sample(const ExpressionHandle &f, const vector<double> &x)
+{
+    vector<double> y(x.size());
+    f->function().evalBatch(x.data(), y.data(), x.size());
+    return y;
+}
+
+InterpolationResult InterpolationMethods::lagrange(const ExpressionHandle &f, const vector<double> &x, const double &x_, bool symbolic)
+{
+    return lagrange(x, sample(f, x), x_, f->variable(), symbolic);
+}
+
+InterpolationResult InterpolationMethods::newtonForward(const ExpressionHandle &f, const vector<double> &x, const double &x_, bool symbolic)
+{
+    return newtonForward(x, sample(f, x), x_, f->variable(), symbolic);
+}
 
-    History.P = make_pair(P_ex, P_v);
+InterpolationResult InterpolationMethods::newtonBackward(const ExpressionHandle &f, const vector<double> &x, const double &x_, bool symbolic)
+{
+    return newtonBackward(x, sample(f, x), x_, f->variable(), symbolic);
+}
 
+InterpolationResult InterpolationMethods::chebyshev(const ExpressionHandle &f, double a, double b, const double &x_,
+                                                    bool symbolic, double tol)
+{
+    InterpolationResult History;
+    auto proxy = make_shared<ChebyshevProxy>(f->function(), a, b, tol);
+    History.P = make_pair(symbolic && proxy->valid() ? proxy->polynomial(f->variable()) : ex(), (*proxy)(x_));
+    History.Chebyshev = proxy;
     return History;
 }
 
-InterpolationResult InterpolationMethods::NewtonTable(const vector<double> &x, const std::vector<double> &y)
+InterpolationResult InterpolationMethods::scattered(const vector<double> &points, const vector<double> &values,
+                                                    unsigned dimensions, const vector<double> &at, RbfKernel kernel,
+                                                    double radius)
 {
     InterpolationResult History;
-    History.D.push_back(y);
-    for (int n = 1; n < x.size(); ++n) {
-        vector<double> dn(x.size() - n);
-        for (int m = 0; m < x.size() - n; ++m) {
-            dn[m] = (History.D[n-1][m+1] - History.D[n-1][m])/(x[n+m] - x[m]);
-        }
-        History.D.push_back(dn);
+    if (at.size() != dimensions) {
+        cerr << "The evaluation point needs " << dimensions << " coordinates.\n";
+        return History;
+    }
+    auto rbf = make_shared<RbfInterpolant>(points, values, dimensions, kernel, radius);
+    History.P = make_pair(ex(), (*rbf)(at.data()));
+    History.Rbf = rbf;
+    return History;
+}
+
+InterpolationResult InterpolationMethods::NewtonTable(const DividedDifferences &table)
+{
+    InterpolationResult History;
+    const size_t n = table.size();
+    for (size_t k = 0; k < n; ++k) {
+        vector<double> dk(n - k);
+        for (size_t m = 0; m < n - k; ++m)
+            dk[m] = table.at(k, m);
+        History.D.push_back(dk);
     }
     return History;
 }
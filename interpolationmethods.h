@@ -2,15 +2,161 @@
 #define INTERPOLATIONMETHODS_H
 
 #include <ginac/ginac.h>
+#include <memory>
 #include <vector>
 
+#include "chebyshev.h"
+#include "cubicspline.h"
+#include "expressionregistry.h"
+#include "rbfinterpolation.h"
+
 using namespace std;
 using namespace GiNaC;
 
+/**
+ * Lagrange interpolant in barycentric form,
+ *
+ *   P(t) = sum_j w_j y_j / (t - x_j)  /  sum_j w_j / (t - x_j),
+ *
+ * with w_j = 1 / prod_{k != j} (x_j - x_k). The weights cost O(n^2) double
+ * operations once; each evaluation is then O(n), and is exact at the nodes.
+ * The symbolic polynomial is only built when polynomial() is called.
+ */
+class BarycentricLagrange
+{
+public:
+    BarycentricLagrange() = default;
+
+    /** Nodes must be distinct; otherwise valid() is false and P is NaN. */
+    BarycentricLagrange(const vector<double> &x, const vector<double> &y);
+
+    bool valid() const { return Valid; }
+    size_t size() const { return X.size(); }
+    const vector<double> &weights() const { return W; }
+
+    double operator()(double t) const;
+
+    /**
+     * P at t[0..n-1]. The node loop is outside the query loop, so each pass
+     * is a plain vectorizable loop over a block of queries.
+     */
+    void evalBatch(const double *t, double *out, size_t n) const;
+
+    /** All basis values l_j(t) into l[0..size()-1], in O(n). */
+    void basis(double t, double *l) const;
+
+    /** l_j(sym) = prod_{k != j} (sym - x_k) / (x_j - x_k), built on request. */
+    ex basisPolynomial(size_t j, const symbol &sym) const;
+
+    /** P(sym) = sum_j y_j l_j(sym), built on request. */
+    ex polynomial(const symbol &sym) const;
+
+private:
+    vector<double> X, Y, W;
+    bool Valid = false;
+};
+
+/**
+ * An interpolating polynomial as plain numbers, in nested Newton form:
+ *
+ *   P(t) = c_0 + (t - z_0)(c_1 + (t - z_1)(c_2 + ... (t - z_{n-2}) c_{n-1})),
+ *
+ * evaluated by Horner's rule in O(n) with no symbolic work. With all
+ * centers z_k = 0 this is the usual power-basis Horner form. The ex is
+ * only built by polynomial(), for display.
+ */
+class NewtonPolynomial
+{
+public:
+    NewtonPolynomial() = default;
+
+    /** centers has coefficients.size() - 1 entries (extra ones are ignored). */
+    NewtonPolynomial(vector<double> centers, vector<double> coefficients);
+
+    bool valid() const { return !C.empty(); }
+    size_t degree() const { return C.empty() ? 0 : C.size() - 1; }
+    const vector<double> &centers() const { return Z; }
+    const vector<double> &coefficients() const { return C; }
+
+    double operator()(double t) const;
+
+    /**
+     * P at t[0..n-1]. The coefficient loop is outside the query loop, so
+     * each Horner step is a plain vectorizable loop over a block of queries.
+     */
+    void evalBatch(const double *t, double *out, size_t n) const;
+
+    /**
+     * a_0..a_degree with P(t) = sum_k a_k t^k, by expanding the nested
+     * form in O(n^2). Ill-conditioned for many or far-from-0 nodes.
+     */
+    vector<double> powerCoefficients() const;
+
+    /** P(sym) in powers of sym, from powerCoefficients(). */
+    ex polynomial(const symbol &sym) const;
+
+private:
+    vector<double> Z, C;
+};
+
+/**
+ * Newton divided differences, grown one point at a time.
+ *
+ * All differences live in one contiguous triangular buffer: row i holds
+ * the diagonal added with point i, f[x_i], f[x_{i-1}, x_i], ...,
+ * f[x_0..x_i], at offset i(i+1)/2. append() computes that row from the
+ * previous one in O(n) time and memory, so a live feed never rebuilds the
+ * table. Both Newton forms are evaluated by Horner's rule straight from the
+ * buffer; expressions are only built by the *Polynomial() calls.
+ */
+class DividedDifferences
+{
+public:
+    DividedDifferences() = default;
+    DividedDifferences(const vector<double> &x, const vector<double> &y);
+
+    /**
+     * Add (x, y) as the newest point.
+     * @return  false, leaving the table as it was, when x repeats a node
+     */
+    bool append(double x, double y);
+
+    size_t size() const { return X.size(); }
+    const vector<double> &nodes() const { return X; }
+
+    /** f[x_start, ..., x_{start+order}]. */
+    double at(size_t order, size_t start) const { return T[row(start + order) + order]; }
+
+    /** Forward form from x_0: sum_k f[x_0..x_k] (t - x_0)...(t - x_{k-1}). */
+    double forward(double t) const;
+
+    /** Backward form from x_{n-1}: sum_k f[x_{n-1-k}..x_{n-1}] (t - x_{n-1})...(t - x_{n-k}). */
+    double backward(double t) const;
+
+    /** The two Newton forms as numeric polynomials, copied out of the buffer. */
+    NewtonPolynomial forwardForm() const;
+    NewtonPolynomial backwardForm() const;
+
+    ex forwardPolynomial(const symbol &sym) const;
+    ex backwardPolynomial(const symbol &sym) const;
+
+private:
+    static size_t row(size_t i) { return i * (i + 1) / 2; }
+
+    vector<double> X;
+    vector<double> T;
+};
+
 struct InterpolationResult{
     vector<pair<ex, double>> L; // Lagranch L experions, value
     vector<vector<double>> D; // For Newton Methods
     pair<ex, double> P;
+    shared_ptr<const BarycentricLagrange> Barycentric; // Lagrange: numeric interpolant
+    shared_ptr<const DividedDifferences> Differences;  // Newton: the difference table
+    shared_ptr<const NewtonPolynomial> Polynomial;     // Newton: P for batch evaluation
+    shared_ptr<const CubicSpline> Spline;              // spline: the pieces
+    shared_ptr<const ChebyshevProxy> Chebyshev;        // Chebyshev: the proxy
+    shared_ptr<const RbfInterpolant> Rbf;              // scattered: the interpolant
 };
 
 class InterpolationMethods
@@ -22,24 +168,36 @@ public:
      * Compute the Lagrange interpolating polynomial P(x) for given nodes and values,
      * and evaluate at point x0.
      *
+     * The values come from the barycentric form (see BarycentricLagrange),
+     * which the result keeps for further queries. The basis and polynomial
+     * expressions are only built when `symbolic` is set; otherwise their ex
+     * parts are left empty.
+     *
      * @param xs   Abscissae x0...xN-1
      * @param ys   Ordinates y0...yN-1
      * @param x0   Evaluation point
      * @param xSym Symbol for x
      * @return     InterpolationResult with lagrangeBasis, polynomial, empty differenceTable
      */
-    InterpolationResult lagrange(const vector<double> &x, const std::vector<double> &y, const double &x_, const symbol &sym);
+    InterpolationResult lagrange(const vector<double> &x, const std::vector<double> &y, const double &x_, const symbol &sym,
+                                 bool symbolic = true);
 
     /**
      * Build Newton forward-difference table and polynomial, evaluate at x0.
      *
+     * The value is computed by Horner's rule from a DividedDifferences
+     * table, kept in the result along with P as a NewtonPolynomial for
+     * evaluating many more points. D and the polynomial ex are only filled
+     * when `symbolic` is set.
+     *
      * @param xs   Abscissae
      * @param ys   Ordinates
      * @param x0   Evaluation point
      * @param xSym Symbol for x
      * @return     InterpolationResult with differenceTable, polynomial, empty lagrangeBasis
      */
-    InterpolationResult newtonForward(const vector<double> &x, const std::vector<double> &y, const double &x_, const symbol &sym);
+    InterpolationResult newtonForward(const vector<double> &x, const std::vector<double> &y, const double &x_, const symbol &sym,
+                                      bool symbolic = true);
 
     /**
      * Build Newton backward-difference table and polynomial, evaluate at x0.
@@ -50,7 +208,64 @@ public:
      * @param xSym Symbol for x
      * @return     InterpolationResult with differenceTable, polynomial, empty lagrangeBasis
      */
-    InterpolationResult newtonBackward(const vector<double> &x, const std::vector<double> &y, const double &x_, const symbol &sym);
+    InterpolationResult newtonBackward(const vector<double> &x, const std::vector<double> &y, const double &x_, const symbol &sym,
+                                       bool symbolic = true);
+
+    /**
+     * Interpolate a known function: the ordinates are f(x) at the given
+     * nodes, evaluated through the registry's compiled evaluator, and the
+     * polynomial is built in f's own variable.
+     *
+     * @param f    Registry handle of f(x)
+     * @param xs   Abscissae
+     * @param x0   Evaluation point
+     */
+    InterpolationResult lagrange(const ExpressionHandle &f, const vector<double> &x, const double &x_, bool symbolic = true);
+    InterpolationResult newtonForward(const ExpressionHandle &f, const vector<double> &x, const double &x_, bool symbolic = true);
+    InterpolationResult newtonBackward(const ExpressionHandle &f, const vector<double> &x, const double &x_, bool symbolic = true);
+
+    /**
+     * Cubic spline through the points, which are sorted by x first.
+     * Unlike a single polynomial it stays well behaved for any number of
+     * points; see CubicSpline for queries beyond x0.
+     *
+     * @param boundary               End conditions
+     * @param startSlope, endSlope   Clamped only: S' at the first and last x
+     * @return  P.second = S(x0), and when `symbolic` P.first is the piece
+     *          containing x0; the spline is kept in Spline
+     */
+    InterpolationResult spline(const vector<double> &x, const std::vector<double> &y, const double &x_, const symbol &sym,
+                               SplineBoundary boundary, bool symbolic = true, double startSlope = 0, double endSlope = 0);
+
+    /**
+     * Chebyshev proxy of a known function on [a, b], with the degree chosen
+     * from the decay of its coefficients (see ChebyshevProxy). Unlike the
+     * node-based methods above the points are picked for f, so it suits
+     * an expensive f that will be evaluated many more times.
+     *
+     * @param tol  Coefficient cutoff relative to max|f|; 0 for machine precision
+     * @return     P.second = p(x0), and when `symbolic` P.first = p in
+     *             powers of f's variable; the proxy (degree, max error,
+     *             batch evaluation) is kept in Chebyshev
+     */
+    InterpolationResult chebyshev(const ExpressionHandle &f, double a, double b, const double &x_,
+                                  bool symbolic = true, double tol = 0);
+
+    /**
+     * Interpolate scattered data in 1 to 3 dimensions with compactly
+     * supported radial basis functions (see RbfInterpolant). There is no
+     * polynomial, so P.first is left empty.
+     *
+     * @param points      points[i * dimensions + k] is coordinate k of point i
+     * @param values      The value at each point
+     * @param at          Evaluation point, `dimensions` coordinates
+     * @param radius      Finest support radius; 0 to pick one from the data
+     * @return  P.second = s(at); the interpolant is kept in Rbf for
+     *          batch queries
+     */
+    InterpolationResult scattered(const vector<double> &points, const vector<double> &values, unsigned dimensions,
+                                  const vector<double> &at, RbfKernel kernel = RbfKernel::WendlandC2,
+                                  double radius = 0);
 private:
 
     /**
@@ -58,11 +273,13 @@ private:
      *
      * Table[k][m] = (Table[k-1][m+1] - Table[k-1][m]) / (x[m+k] - x[m])
      *
+     * Copied out of the flat DividedDifferences buffer, for display.
+     *
      * @param xs Abscissae
      * @param ys Ordinates
      * @return   InterpolationResult with differenceTable filled
      */
-    InterpolationResult NewtonTable(const vector<double> &x, const std::vector<double> &y);
+    InterpolationResult NewtonTable(const DividedDifferences &table);
 };
 
 #endif // INTERPOLATIONMETHODS_H
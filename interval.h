@@ -0,0 +1,277 @@
+#ifndef INTERVAL_H
+#define INTERVAL_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/**
+ * Closed interval [Lo, Hi] of doubles, with the inclusion-isotonic
+ * operations CompiledFunction::evalInterval() needs.
+ *
+ * Every result encloses all values of the operation on its arguments:
+ * bounds are rounded outward one ulp after exact IEEE operations and two
+ * after libm calls (which glibc keeps within one ulp). Domain violations are
+ * clipped (sqrt([-1, 4]) = [0, 2]); an interval wholly outside the domain is
+ * empty (NaN bounds), which proves f has no value, and so no root, there.
+ */
+struct Interval
+{
+    double Lo = 0;
+    double Hi = 0;
+
+    Interval() = default;
+    explicit Interval(double v) : Lo(v), Hi(v) {}
+    Interval(double lo, double hi) : Lo(lo), Hi(hi) {}
+
+    static Interval empty() { return {NAN, NAN}; }
+    static Interval entire() { return {-INFINITY, INFINITY}; }
+
+    bool isEmpty() const { return !(Lo <= Hi); }
+    bool contains(double v) const { return Lo <= v && v <= Hi; }
+    double width() const { return Hi - Lo; }
+    double mid() const { return Lo + 0.5 * (Hi - Lo); }
+};
+
+inline double roundDown(double v, int ulps = 1)
+{
+    for (int i = 0; i < ulps; ++i)
+        v = std::nextafter(v, -INFINITY);
+    return v;
+}
+
+inline double roundUp(double v, int ulps = 1)
+{
+    for (int i = 0; i < ulps; ++i)
+        v = std::nextafter(v, INFINITY);
+    return v;
+}
+
+// Interval of a libm function increasing on the (already clipped) argument.
+template <typename F>
+inline Interval increasing(const Interval &a, F f)
+{
+    if (a.isEmpty())
+        return Interval::empty();
+    return {roundDown(f(a.Lo), 2), roundUp(f(a.Hi), 2)};
+}
+
+inline Interval operator+(const Interval &a, const Interval &b)
+{
+    return {roundDown(a.Lo + b.Lo), roundUp(a.Hi + b.Hi)};
+}
+
+inline Interval operator-(const Interval &a, const Interval &b)
+{
+    return {roundDown(a.Lo - b.Hi), roundUp(a.Hi - b.Lo)};
+}
+
+inline Interval operator-(const Interval &a)
+{
+    return {-a.Hi, -a.Lo};
+}
+
+// 0 * inf counts as 0: the infinite bound is a limit, never attained.
+inline double boundProduct(double x, double y)
+{
+    return (x == 0 || y == 0) ? 0.0 : x * y;
+}
+
+inline Interval operator*(const Interval &a, const Interval &b)
+{
+    if (a.isEmpty() || b.isEmpty())
+        return Interval::empty();
+    const double p[4] = {boundProduct(a.Lo, b.Lo), boundProduct(a.Lo, b.Hi),
+                         boundProduct(a.Hi, b.Lo), boundProduct(a.Hi, b.Hi)};
+    return {roundDown(*std::min_element(p, p + 4)), roundUp(*std::max_element(p, p + 4))};
+}
+
+inline Interval operator/(const Interval &a, const Interval &b)
+{
+    if (a.isEmpty() || b.isEmpty() || (b.Lo == 0 && b.Hi == 0))
+        return Interval::empty();
+    if (b.contains(0))
+        return Interval::entire();
+    const double q[4] = {a.Lo / b.Lo, a.Lo / b.Hi, a.Hi / b.Lo, a.Hi / b.Hi};
+    return {roundDown(*std::min_element(q, q + 4)), roundUp(*std::max_element(q, q + 4))};
+}
+
+inline Interval fabs(const Interval &a)
+{
+    if (a.Lo >= 0)
+        return a;
+    if (a.Hi <= 0)
+        return -a;
+    return {0.0, std::max(-a.Lo, a.Hi)};
+}
+
+inline Interval powInt(const Interval &a, int n)
+{
+    if (n == 0)
+        return Interval(1.0);
+    if (n < 0)
+        return Interval(1.0) / powInt(a, -n);
+    if (n == 1)
+        return a;
+
+    auto p = [n](double v) { return std::pow(v, n); };
+    if (n % 2 == 1)
+        return increasing(a, p);
+    return increasing(fabs(a), p);
+}
+
+inline Interval sqrt(const Interval &a)
+{
+    if (a.isEmpty() || a.Hi < 0)
+        return Interval::empty();
+    // IEEE sqrt is correctly rounded: one ulp of widening is enough.
+    return {std::max(0.0, roundDown(std::sqrt(std::max(a.Lo, 0.0)))), roundUp(std::sqrt(a.Hi))};
+}
+
+inline Interval exp(const Interval &a)
+{
+    Interval r = increasing(a, [](double v) { return std::exp(v); });
+    r.Lo = std::max(r.Lo, 0.0);
+    return r;
+}
+
+inline Interval log(const Interval &a)
+{
+    if (a.isEmpty() || a.Hi <= 0)
+        return Interval::empty();
+    return increasing(Interval(std::max(a.Lo, 0.0), a.Hi), [](double v) { return std::log(v); });
+}
+
+inline Interval pow(const Interval &a, const Interval &b)
+{
+    if (b.Lo == b.Hi && b.Lo == std::floor(b.Lo) && std::fabs(b.Lo) <= 64)
+        return powInt(a, static_cast<int>(b.Lo));
+    // Real powers need a positive base, as in std::pow.
+    return exp(b * log(a));
+}
+
+// sin or cos on [lo, hi], |hi - lo| < 2pi: the extremes are the endpoint
+// values unless a peak lies inside. Peaks sit at phase + m*pi (m even: 1,
+// m odd: -1); they are searched on a slightly enlarged range, which can only
+// add extremes, so rounding in (x - phase) / pi never loses one.
+inline Interval trig(const Interval &a, bool isSin)
+{
+    const double Pi = 3.14159265358979323846;
+    if (a.isEmpty())
+        return Interval::empty();
+    if (!(a.width() < 2 * Pi))
+        return {-1.0, 1.0};
+
+    const double v0 = isSin ? std::sin(a.Lo) : std::cos(a.Lo);
+    const double v1 = isSin ? std::sin(a.Hi) : std::cos(a.Hi);
+    double lo = roundDown(std::min(v0, v1), 2), hi = roundUp(std::max(v0, v1), 2);
+
+    const double phase = isSin ? Pi / 2 : 0.0;
+    const double slack = 1e-12 * std::max(1.0, std::max(std::fabs(a.Lo), std::fabs(a.Hi)));
+    const double m0 = std::ceil((a.Lo - phase - slack) / Pi);
+    const double m1 = std::floor((a.Hi - phase + slack) / Pi);
+    for (double m = m0; m <= m1; ++m) {
+        if (std::fmod(m, 2.0) == 0)
+            hi = 1.0;
+        else
+            lo = -1.0;
+    }
+    return {std::max(lo, -1.0), std::min(hi, 1.0)};
+}
+
+inline Interval cos(const Interval &a)
+{
+    return trig(a, false);
+}
+
+inline Interval sin(const Interval &a)
+{
+    return trig(a, true);
+}
+
+inline Interval tan(const Interval &a)
+{
+    const double Pi = 3.14159265358979323846;
+    if (a.isEmpty())
+        return Interval::empty();
+    if (!(a.width() < Pi))
+        return Interval::entire();
+    // A pole at pi/2 + m*pi inside [lo, hi] makes tan unbounded.
+    const double slack = 1e-12 * std::max(1.0, std::max(std::fabs(a.Lo), std::fabs(a.Hi)));
+    if (std::floor((a.Hi - Pi / 2 + slack) / Pi) >= std::ceil((a.Lo - Pi / 2 - slack) / Pi))
+        return Interval::entire();
+    return increasing(a, [](double v) { return std::tan(v); });
+}
+
+inline Interval asin(const Interval &a)
+{
+    if (a.isEmpty() || a.Lo > 1 || a.Hi < -1)
+        return Interval::empty();
+    return increasing(Interval(std::max(a.Lo, -1.0), std::min(a.Hi, 1.0)),
+                      [](double v) { return std::asin(v); });
+}
+
+inline Interval acos(const Interval &a)
+{
+    if (a.isEmpty() || a.Lo > 1 || a.Hi < -1)
+        return Interval::empty();
+    const double lo = std::max(a.Lo, -1.0), hi = std::min(a.Hi, 1.0);
+    return {roundDown(std::acos(hi), 2), roundUp(std::acos(lo), 2)};
+}
+
+inline Interval atan(const Interval &a)
+{
+    return increasing(a, [](double v) { return std::atan(v); });
+}
+
+inline Interval atan2(const Interval &y, const Interval &x)
+{
+    const double Pi = 3.14159265358979323846;
+    if (y.isEmpty() || x.isEmpty())
+        return Interval::empty();
+    // Right half-plane: atan2(y, x) = atan(y / x), continuous there.
+    if (x.Lo > 0)
+        return atan(y / x);
+    return {roundDown(-Pi), roundUp(Pi)};
+}
+
+inline Interval sinh(const Interval &a)
+{
+    return increasing(a, [](double v) { return std::sinh(v); });
+}
+
+inline Interval cosh(const Interval &a)
+{
+    const Interval m = fabs(a);
+    Interval r = increasing(m, [](double v) { return std::cosh(v); });
+    r.Lo = std::max(r.Lo, 1.0);
+    return r;
+}
+
+inline Interval tanh(const Interval &a)
+{
+    Interval r = increasing(a, [](double v) { return std::tanh(v); });
+    return {std::max(r.Lo, -1.0), std::min(r.Hi, 1.0)};
+}
+
+inline Interval asinh(const Interval &a)
+{
+    return increasing(a, [](double v) { return std::asinh(v); });
+}
+
+inline Interval acosh(const Interval &a)
+{
+    if (a.isEmpty() || a.Hi < 1)
+        return Interval::empty();
+    return increasing(Interval(std::max(a.Lo, 1.0), a.Hi), [](double v) { return std::acosh(v); });
+}
+
+inline Interval atanh(const Interval &a)
+{
+    if (a.isEmpty() || a.Lo >= 1 || a.Hi <= -1)
+        return Interval::empty();
+    return increasing(Interval(std::max(a.Lo, -1.0), std::min(a.Hi, 1.0)),
+                      [](double v) { return std::atanh(v); });
+}
+
+#endif // INTERVAL_H
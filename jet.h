@@ -0,0 +1,338 @@
+#ifndef JET_H
+#define JET_H
+
+#include <cmath>
+
+/**
+ * Truncated Taylor series of order N: f(x0 + t) = C[0] + C[1] t + ... + C[N] t^N.
+ *
+ * Jet<1> is the dual number (value, derivative) used by Newton's method;
+ * higher orders give f'' and beyond for Halley-type iterations. Seeding the
+ * variable as Jet<N>::variable(x0) and running an expression through the
+ * operations below propagates all N derivatives in a single pass.
+ */
+template <int N>
+struct Jet
+{
+    double C[N + 1] = {};
+
+    static Jet constant(double value)
+    {
+        Jet r;
+        r.C[0] = value;
+        return r;
+    }
+
+    static Jet variable(double x0)
+    {
+        Jet r;
+        r.C[0] = x0;
+        if (N > 0)
+            r.C[1] = 1.0;
+        return r;
+    }
+
+    double value() const { return C[0]; }
+
+    /** k-th derivative, k! * C[k]. */
+    double derivative(int k = 1) const
+    {
+        double factorial = 1;
+        for (int i = 2; i <= k; ++i)
+            factorial *= i;
+        return factorial * C[k];
+    }
+};
+
+template <int N>
+Jet<N> operator+(Jet<N> a, const Jet<N> &b)
+{
+    for (int k = 0; k <= N; ++k)
+        a.C[k] += b.C[k];
+    return a;
+}
+
+template <int N>
+Jet<N> operator-(Jet<N> a, const Jet<N> &b)
+{
+    for (int k = 0; k <= N; ++k)
+        a.C[k] -= b.C[k];
+    return a;
+}
+
+template <int N>
+Jet<N> operator-(Jet<N> a)
+{
+    for (int k = 0; k <= N; ++k)
+        a.C[k] = -a.C[k];
+    return a;
+}
+
+template <int N>
+Jet<N> operator*(const Jet<N> &a, const Jet<N> &b)
+{
+    Jet<N> r;
+    for (int k = 0; k <= N; ++k)
+        for (int j = 0; j <= k; ++j)
+            r.C[k] += a.C[j] * b.C[k - j];
+    return r;
+}
+
+template <int N>
+Jet<N> operator/(const Jet<N> &a, const Jet<N> &b)
+{
+    Jet<N> q;
+    for (int k = 0; k <= N; ++k) {
+        double s = a.C[k];
+        for (int j = 0; j < k; ++j)
+            s -= q.C[j] * b.C[k - j];
+        q.C[k] = s / b.C[0];
+    }
+    return q;
+}
+
+// Series of g(a) from g(a0) and the series of g'(a): g_k = (1/k) sum j a_j d_{k-j}.
+template <int N>
+Jet<N> jetCompose(double g0, const Jet<N> &a, const Jet<N> &d)
+{
+    Jet<N> r;
+    r.C[0] = g0;
+    for (int k = 1; k <= N; ++k) {
+        double s = 0;
+        for (int j = 1; j <= k; ++j)
+            s += j * a.C[j] * d.C[k - j];
+        r.C[k] = s / k;
+    }
+    return r;
+}
+
+template <int N>
+Jet<N> exp(const Jet<N> &a)
+{
+    Jet<N> e;
+    e.C[0] = std::exp(a.C[0]);
+    for (int k = 1; k <= N; ++k) {
+        double s = 0;
+        for (int j = 1; j <= k; ++j)
+            s += j * a.C[j] * e.C[k - j];
+        e.C[k] = s / k;
+    }
+    return e;
+}
+
+template <int N>
+Jet<N> log(const Jet<N> &a)
+{
+    Jet<N> l;
+    l.C[0] = std::log(a.C[0]);
+    for (int k = 1; k <= N; ++k) {
+        double s = 0;
+        for (int j = 1; j < k; ++j)
+            s += j * l.C[j] * a.C[k - j];
+        l.C[k] = (a.C[k] - s / k) / a.C[0];
+    }
+    return l;
+}
+
+template <int N>
+Jet<N> sqrt(const Jet<N> &a)
+{
+    Jet<N> r;
+    r.C[0] = std::sqrt(a.C[0]);
+    for (int k = 1; k <= N; ++k) {
+        double s = a.C[k];
+        for (int j = 1; j < k; ++j)
+            s -= r.C[j] * r.C[k - j];
+        r.C[k] = s / (2 * r.C[0]);
+    }
+    return r;
+}
+
+/** a^n by repeated squaring; exact at a0 = 0, unlike exp(n log a). */
+template <int N>
+Jet<N> powInt(Jet<N> a, int n)
+{
+    bool invert = n < 0;
+    unsigned int k = invert ? -n : n;
+    Jet<N> r = Jet<N>::constant(1.0);
+    while (k) {
+        if (k & 1)
+            r = r * a;
+        a = a * a;
+        k >>= 1;
+    }
+    return invert ? Jet<N>::constant(1.0) / r : r;
+}
+
+template <int N>
+Jet<N> pow(const Jet<N> &a, const Jet<N> &b)
+{
+    bool constantExponent = true;
+    for (int k = 1; k <= N; ++k)
+        constantExponent = constantExponent && b.C[k] == 0;
+
+    if (!constantExponent || a.C[0] == 0)
+        return exp(b * log(a));
+
+    // p = a^r: p_k = (1 / (k a0)) sum ((r+1) j - k) a_j p_{k-j}
+    const double r = b.C[0];
+    Jet<N> p;
+    p.C[0] = std::pow(a.C[0], r);
+    for (int k = 1; k <= N; ++k) {
+        double s = 0;
+        for (int j = 1; j <= k; ++j)
+            s += ((r + 1) * j - k) * a.C[j] * p.C[k - j];
+        p.C[k] = s / (k * a.C[0]);
+    }
+    return p;
+}
+
+template <int N>
+Jet<N> fabs(const Jet<N> &a)
+{
+    return a.C[0] < 0 ? -a : a;
+}
+
+// sin and cos (or sinh and cosh with sign = +1) share one recurrence.
+template <int N>
+void jetSinCos(const Jet<N> &a, Jet<N> &s, Jet<N> &c, double sign)
+{
+    s.C[0] = sign < 0 ? std::sin(a.C[0]) : std::sinh(a.C[0]);
+    c.C[0] = sign < 0 ? std::cos(a.C[0]) : std::cosh(a.C[0]);
+    for (int k = 1; k <= N; ++k) {
+        double ss = 0, cs = 0;
+        for (int j = 1; j <= k; ++j) {
+            ss += j * a.C[j] * c.C[k - j];
+            cs += j * a.C[j] * s.C[k - j];
+        }
+        s.C[k] = ss / k;
+        c.C[k] = sign * cs / k;
+    }
+}
+
+template <int N>
+Jet<N> sin(const Jet<N> &a)
+{
+    Jet<N> s, c;
+    jetSinCos(a, s, c, -1.0);
+    return s;
+}
+
+template <int N>
+Jet<N> cos(const Jet<N> &a)
+{
+    Jet<N> s, c;
+    jetSinCos(a, s, c, -1.0);
+    return c;
+}
+
+template <int N>
+Jet<N> sinh(const Jet<N> &a)
+{
+    Jet<N> s, c;
+    jetSinCos(a, s, c, 1.0);
+    return s;
+}
+
+template <int N>
+Jet<N> cosh(const Jet<N> &a)
+{
+    Jet<N> s, c;
+    jetSinCos(a, s, c, 1.0);
+    return c;
+}
+
+// tan' = 1 + tan^2 and tanh' = 1 - tanh^2 refer back to the result, so the
+// derivative series is extended one coefficient at a time.
+template <int N>
+Jet<N> jetTan(const Jet<N> &a, double t0, double sign)
+{
+    Jet<N> t, d;
+    t.C[0] = t0;
+    d.C[0] = 1 + sign * t0 * t0;
+    for (int k = 1; k <= N; ++k) {
+        double s = 0;
+        for (int j = 1; j <= k; ++j)
+            s += j * a.C[j] * d.C[k - j];
+        t.C[k] = s / k;
+        double sq = 0;
+        for (int j = 0; j <= k; ++j)
+            sq += t.C[j] * t.C[k - j];
+        d.C[k] = sign * sq;
+    }
+    return t;
+}
+
+template <int N>
+Jet<N> tan(const Jet<N> &a)
+{
+    return jetTan(a, std::tan(a.C[0]), 1.0);
+}
+
+template <int N>
+Jet<N> tanh(const Jet<N> &a)
+{
+    return jetTan(a, std::tanh(a.C[0]), -1.0);
+}
+
+template <int N>
+Jet<N> asin(const Jet<N> &a)
+{
+    const Jet<N> one = Jet<N>::constant(1.0);
+    return jetCompose(std::asin(a.C[0]), a, one / sqrt(one - a * a));
+}
+
+template <int N>
+Jet<N> acos(const Jet<N> &a)
+{
+    const Jet<N> one = Jet<N>::constant(1.0);
+    return jetCompose(std::acos(a.C[0]), a, -(one / sqrt(one - a * a)));
+}
+
+template <int N>
+Jet<N> atan(const Jet<N> &a)
+{
+    const Jet<N> one = Jet<N>::constant(1.0);
+    return jetCompose(std::atan(a.C[0]), a, one / (one + a * a));
+}
+
+template <int N>
+Jet<N> asinh(const Jet<N> &a)
+{
+    const Jet<N> one = Jet<N>::constant(1.0);
+    return jetCompose(std::asinh(a.C[0]), a, one / sqrt(a * a + one));
+}
+
+template <int N>
+Jet<N> acosh(const Jet<N> &a)
+{
+    const Jet<N> one = Jet<N>::constant(1.0);
+    return jetCompose(std::acosh(a.C[0]), a, one / sqrt(a * a - one));
+}
+
+template <int N>
+Jet<N> atanh(const Jet<N> &a)
+{
+    const Jet<N> one = Jet<N>::constant(1.0);
+    return jetCompose(std::atanh(a.C[0]), a, one / (one - a * a));
+}
+
+template <int N>
+Jet<N> atan2(const Jet<N> &y, const Jet<N> &x)
+{
+    // d/dt atan2(y, x) = (x y' - y x') / (x^2 + y^2)
+    Jet<N> dy, dx;
+    for (int k = 0; k < N; ++k) {
+        dy.C[k] = (k + 1) * y.C[k + 1];
+        dx.C[k] = (k + 1) * x.C[k + 1];
+    }
+    const Jet<N> w = (x * dy - y * dx) / (x * x + y * y);
+
+    Jet<N> r;
+    r.C[0] = std::atan2(y.C[0], x.C[0]);
+    for (int k = 1; k <= N; ++k)
+        r.C[k] = w.C[k - 1] / k;
+    return r;
+}
+
+#endif // JET_H
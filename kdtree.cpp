@@ -0,0 +1,49 @@
+#include "kdtree.h"
+
+#include <algorithm>
+#include <numeric>
+
+KdTree::KdTree(const double *points, size_t n, unsigned dimensions) : Dimensions(dimensions)
+{
+    if (n == 0 || dimensions == 0)
+        return;
+    vector<size_t> order(n);
+    iota(order.begin(), order.end(), 0);
+    Axis.assign(n, 0);
+    build(0, n, order, points);
+
+    Points.resize(n * dimensions);
+    for (size_t i = 0; i < n; ++i)
+        copy(points + order[i] * dimensions, points + (order[i] + 1) * dimensions, &Points[i * dimensions]);
+    Index = move(order);
+}
+
+void KdTree::build(size_t lo, size_t hi, vector<size_t> &order, const double *points)
+{
+    if (hi - lo <= Leaf)
+        return;
+
+    // Split across the axis along which the range is widest.
+    unsigned axis = 0;
+    double widest = -1;
+    for (unsigned k = 0; k < Dimensions; ++k) {
+        double low = points[order[lo] * Dimensions + k], high = low;
+        for (size_t i = lo + 1; i < hi; ++i) {
+            const double v = points[order[i] * Dimensions + k];
+            low = min(low, v);
+            high = max(high, v);
+        }
+        if (high - low > widest) {
+            widest = high - low;
+            axis = k;
+        }
+    }
+
+    const size_t mid = lo + (hi - lo) / 2;
+    nth_element(order.begin() + lo, order.begin() + mid, order.begin() + hi, [&](size_t a, size_t b) {
+        return points[a * Dimensions + axis] < points[b * Dimensions + axis];
+    });
+    Axis[mid] = static_cast<uint8_t>(axis);
+    build(lo, mid, order, points);
+    build(mid + 1, hi, order, points);
+}
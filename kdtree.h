@@ -0,0 +1,97 @@
+#ifndef KDTREE_H
+#define KDTREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Static k-d tree over n points of `dimensions` coordinates.
+ *
+ * The tree is implicit: the points are permuted so that every subrange
+ * [lo, hi) has its splitting point at mid = (lo + hi) / 2, with smaller
+ * coordinates on the left, and only the split axis of each node is stored.
+ * Coordinates are copied in that order, so a search reads neighbouring
+ * memory and positions in the tree can index per-point data directly.
+ * Building is O(n log n) (median selection per level); the tree is
+ * read-only afterwards, so any number of threads may search it at once.
+ */
+class KdTree
+{
+public:
+    KdTree() = default;
+
+    /** points[i * dimensions + k] is coordinate k of point i. */
+    KdTree(const double *points, size_t n, unsigned dimensions);
+
+    size_t size() const { return Index.size(); }
+    unsigned dimensions() const { return Dimensions; }
+
+    /** Coordinates of the point at tree position i. */
+    const double *point(size_t i) const { return &Points[i * Dimensions]; }
+
+    /** Input index of the point at tree position i. */
+    size_t index(size_t i) const { return Index[i]; }
+
+    /**
+     * Call visit(i, d2) for every point within distance r of q, with i its
+     * tree position and d2 the squared distance. No allocation.
+     */
+    template <class F>
+    void radius(const double *q, double r, F &&visit) const
+    {
+        if (Index.empty())
+            return;
+        const double r2 = r * r;
+        // Explicit stack of subranges; a balanced tree is at most 64 deep,
+        // and each level pushes at most one range besides the one followed.
+        struct Range { size_t Lo, Hi; };
+        Range stack[2 * 64];
+        int top = 0;
+        stack[top++] = {0, Index.size()};
+        while (top > 0) {
+            const Range range = stack[--top];
+            if (range.Hi - range.Lo <= Leaf) {
+                for (size_t i = range.Lo; i < range.Hi; ++i) {
+                    const double d2 = distance2(q, i);
+                    if (d2 <= r2)
+                        visit(i, d2);
+                }
+                continue;
+            }
+            const size_t mid = range.Lo + (range.Hi - range.Lo) / 2;
+            const double d2 = distance2(q, mid);
+            if (d2 <= r2)
+                visit(mid, d2);
+            const double diff = q[Axis[mid]] - Points[mid * Dimensions + Axis[mid]];
+            // Left holds coordinates <= the split, right >= it.
+            if (diff - r <= 0)
+                stack[top++] = {range.Lo, mid};
+            if (diff + r >= 0)
+                stack[top++] = {mid + 1, range.Hi};
+        }
+    }
+
+private:
+    static const size_t Leaf = 8; // subranges this small are scanned
+
+    double distance2(const double *q, size_t i) const
+    {
+        const double *p = &Points[i * Dimensions];
+        double d2 = 0;
+        for (unsigned k = 0; k < Dimensions; ++k)
+            d2 += (q[k] - p[k]) * (q[k] - p[k]);
+        return d2;
+    }
+
+    void build(size_t lo, size_t hi, vector<size_t> &order, const double *points);
+
+    unsigned Dimensions = 0;
+    vector<double> Points;   // tree order
+    vector<size_t> Index;    // tree position -> input index
+    vector<uint8_t> Axis;    // split axis of the node at each tree position
+};
+
+#endif // KDTREE_H
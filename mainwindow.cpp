@@ -1,10 +1,18 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "simdmath.h"
+#include "threadpool.h"
 
 #include <QStandardItemModel>
 #include <QStandardItem>
+#include <QStatusBar>
+#include <QElapsedTimer>
+#include <QFileDialog>
+#include <QFileInfo>
 
 static QStandardItem* comboItem(QComboBox *combo, int index);
+static QString nativeSummary(const NativeReport &report);
+static QString registrySummary();
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -91,10 +99,12 @@ void MainWindow::on_CurveFittingPageBtn_clicked()
  * (Bisection, Secant, or Newton), computes the root, and populates the UI
  * with the result table and info text.
  *
+ * The equation comes from the shared ExpressionRegistry, so solving the same
+ * f(x) again skips parsing and compilation.
+ *
  * @note Assumes `RootSolver` is a utility with methods:
- *       - make_full_parser(symbol): returns a parser for expressions in x
- *       - findBracket(fx, x, a, b): finds [a,b] where sign(f(a))≠sign(f(b))
- *       - bisection, secant, newton → each returns a
+ *       - findBracket(fx, a, b): finds [a,b] where sign(f(a))≠sign(f(b))
+ *       - bisection, secant, newton, itp → each returns a
  *         `RootReturn` struct containing:
  *           · double Root            – the computed root
  *           · map<char,vector<double>> RootVariables
@@ -122,46 +132,87 @@ void MainWindow::on_RootSolveButton_clicked()
     // 2. Parse equation
     const std::string eqString = eqText.toStdString();
 
-    symbol x("x");
-    parser p = RootSolver.make_full_parser(x);
-    ex fx;
+    ExpressionHandle fx;
     try {
-        fx = p(eqString);
+        fx = ExpressionRegistry::instance().get(eqString);
     }
     catch (const std::exception&) {
         QMessageBox::warning(this, "Unsupported", "Wrong or unsupported equation!");
         return;
     }
+    statusBar()->showMessage(registrySummary());
 
-    // 3. Locate bracket [a,b]
-    auto bracket = RootSolver.findBracket(fx, x, 0.0, 100.0);
-
-    // 4. Solve using the chosen method
+    const double rangeLow = ui->RootRangeLow->value();
+    const double rangeHigh = ui->RootRangeHigh->value();
+    if (rangeLow >= rangeHigh) {
+        QMessageBox::warning(this, "Invalid Range", "Range start should be less than range end!");
+        return;
+    }
     const int tol      = ui->RootTol->value();
+
+    if (ui->RootAllCheck->isChecked()) {
+        showAllRoots(fx, methodIndex, rangeLow, rangeHigh, tol);
+        return;
+    }
+
+    // 3. Locate every bracket in the range; solve in the first proper one
+    const std::vector<RootBracket> brackets = RootSolver.findBrackets(fx, rangeLow, rangeHigh);
+    std::pair<double, double> bracket = RootMethods::preferredBracket(fx->function(), brackets);
+
+    // 4. Solve using the chosen method, on F itself or on a Chebyshev proxy
+    //    of F over the range
+    const bool useProxy = ui->RootChebCheck->isChecked();
+    ChebyshevProxy proxy;
+    if (useProxy) {
+        proxy = ChebyshevProxy(fx->function(), rangeLow, rangeHigh);
+        if (!proxy.valid()) {
+            QMessageBox::warning(this, "Chebyshev Proxy", "F(x) must be finite on the whole range for a proxy!");
+            return;
+        }
+    }
+
     RootResult rootRes;
     switch (methodIndex) {
     case 1:  // Bisection
-        rootRes = RootSolver.bisection(fx, x, bracket, tol, 100);
+        rootRes = useProxy ? RootSolver.bisection(proxy, bracket, tol, 100)
+                           : RootSolver.bisection(fx, bracket, tol, 100);
         break;
     case 2:  // Secant
-        rootRes = RootSolver.secant(fx, x, bracket, tol, 100);
+        rootRes = useProxy ? RootSolver.secant(proxy, bracket, tol, 100)
+                           : RootSolver.secant(fx, bracket, tol, 100);
         break;
     case 3:  // Newton
-        // Precompute derivative (for info display)
-        diff(fx, x);
-        rootRes = RootSolver.newton(fx, x, bracket, tol, 100);
+        rootRes = useProxy ? RootSolver.newton(proxy, bracket, tol, 100)
+                           : RootSolver.newton(fx, bracket, tol, 100);
+        break;
+    case 4:  // ITP
+        rootRes = useProxy ? RootSolver.itp(proxy, bracket, tol, 100)
+                           : RootSolver.itp(fx, bracket, tol, 100);
         break;
     default:
         return; // should never happen
     }
 
+    // A kernel that could not start (same-sign ends for ITP, equal f for
+    // the secant, no bracket at all) leaves no history to show.
+    const bool bracketing = methodIndex == 1 || methodIndex == 4;
+    if (std::isnan(rootRes.Root) || !rootRes.RootVariables.count('x')
+        || (bracketing && (!rootRes.RootVariables.count('a') || !rootRes.RootVariables.count('b')))) {
+        QString reason = rootRes.Error.empty() ? QString("The method did not converge.")
+                                               : QString::fromStdString(rootRes.Error);
+        if (std::isnan(bracket.first))
+            reason = "No root bracket found in the range.";
+        QMessageBox::warning(this, "No Root", reason);
+        return;
+    }
+
     // 5. Display root
     ui->RootLabel->setText(QString::number(rootRes.Root));
 
     // 6. Build iteration table
     // Decide columns based on method
-    if (methodIndex == 1) {
-        // Bisection: columns a, b, c (midpoint)
+    if (bracketing) {
+        // Bisection & ITP: columns a, b, c (point evaluated)
         ui->RootTable->setColumnCount(3);
         ui->RootTable->setHorizontalHeaderLabels({"a", "b", "c"});
         const auto &A = rootRes.RootVariables.at('a');
@@ -197,15 +248,112 @@ void MainWindow::on_RootSolveButton_clicked()
     // 7. Show info summary
     std::ostringstream info;
     info << "Bracket: [" << bracket.first << ", " << bracket.second << "]\n"
-         << "Iterations: " << rootRes.RootVariables.at('x').size() << "\n";
+         << "Iterations: " << rootRes.RootVariables.at('x').size() << "\n"
+         << (useProxy ? "Proxy evaluations: " : "Function evaluations: ") << rootRes.Evaluations << "\n";
+    if (useProxy)
+        info << "Chebyshev proxy: degree " << proxy.degree()
+             << (proxy.converged() ? "" : " (not converged)") << ", max error "
+             << proxy.maxError() << ", " << proxy.evaluations() << " evaluations of F\n";
+    info << "Brackets on [" << rangeLow << ", " << rangeHigh << "]: " << brackets.size() << "\n";
+    for (size_t i = 0; i < brackets.size() && i < 10; ++i)
+        info << "  [" << brackets[i].Lo << ", " << brackets[i].Hi << "]"
+             << (brackets[i].Isolated ? "" : " (multiple root or cluster)") << "\n";
     if (methodIndex == 3) {
-        // Append derivative expression for Newton
-        ex df = diff(fx, x);
-        info << "f'(x) = " << df << "\n";
+        // Newton takes f' from forward-mode AD; the symbolic derivative is
+        // only built here, once per cached equation, for display.
+        info << "f'(x) = " << fx->derivative() << "\n";
     }
     ui->RootInfo->setPlainText(QString::fromStdString(info.str()));
 }
 
+/**
+ * @brief Multi-root mode of the Root page: every root in [lo, hi].
+ *
+ * Runs RootMethods::allRoots on the shared thread pool and lists the roots
+ * with their iteration counts (the table is capped; the info panel has the
+ * full count and timing).
+ */
+void MainWindow::showAllRoots(const ExpressionHandle &fx, int methodIndex, double lo, double hi, int tol)
+{
+    // Polynomials skip bracketing: every root, real and complex, at once.
+    QElapsedTimer polyTimer;
+    polyTimer.start();
+    const PolynomialRoots poly = RootSolver.polynomialRoots(fx, tol);
+    if (poly.Degree >= 1) {
+        showPolynomialRoots(poly, tol, polyTimer.elapsed());
+        return;
+    }
+
+    const RootMethod method = methodIndex == 1 ? RootMethod::Bisection
+                              : methodIndex == 2 ? RootMethod::Secant
+                              : methodIndex == 3 ? RootMethod::Newton
+                                                 : RootMethod::Itp;
+
+    QElapsedTimer timer;
+    timer.start();
+    const std::vector<RootResult> roots = RootSolver.allRoots(fx, lo, hi, method, tol, 100);
+    const qint64 elapsed = timer.elapsed();
+
+    ui->RootLabel->setText(QString::number(roots.size()) + " roots");
+
+    const int maxRows = 10000;
+    const int rows = std::min<int>(roots.size(), maxRows);
+    ui->RootTable->setColumnCount(3);
+    ui->RootTable->setHorizontalHeaderLabels({"Root", "Iterations", "Evaluations"});
+    ui->RootTable->setRowCount(rows);
+    for (int i = 0; i < rows; ++i) {
+        ui->RootTable->setItem(i, 0, new QTableWidgetItem(
+                                         QString::number(roots[i].Root, 'f', std::max(5, tol))));
+        const auto it = roots[i].RootVariables.find('x');
+        const int iterations = it == roots[i].RootVariables.end() ? 0 : int(it->second.size());
+        ui->RootTable->setItem(i, 1, new QTableWidgetItem(QString::number(iterations)));
+        ui->RootTable->setItem(i, 2, new QTableWidgetItem(QString::number(roots[i].Evaluations)));
+    }
+    long long evaluations = 0;
+    for (const RootResult &r : roots)
+        evaluations += r.Evaluations;
+    ui->RootTable->horizontalHeader()->setStretchLastSection(true);
+
+    std::ostringstream info;
+    info << "Range: [" << lo << ", " << hi << "]\n"
+         << "Roots: " << roots.size() << "\n"
+         << "Function evaluations: " << evaluations << " (refinement only)\n"
+         << "Threads: " << ThreadPool::instance().size() << "\n"
+         << "Time: " << elapsed << " ms\n";
+    if (int(roots.size()) > maxRows)
+        info << "Table shows the first " << maxRows << "\n";
+    ui->RootInfo->setPlainText(QString::fromStdString(info.str()));
+}
+
+/**
+ * @brief All-roots mode for a polynomial f: lists its real and complex
+ *        roots (the range and method do not apply).
+ */
+void MainWindow::showPolynomialRoots(const PolynomialRoots &poly, int tol, qint64 elapsed)
+{
+    ui->RootLabel->setText(QString::number(poly.Roots.size()) + " roots ("
+                           + QString::number(poly.RealCount) + " real)");
+
+    const int rows = poly.Roots.size();
+    ui->RootTable->setColumnCount(2);
+    ui->RootTable->setHorizontalHeaderLabels({"Re", "Im"});
+    ui->RootTable->setRowCount(rows);
+    for (int i = 0; i < rows; ++i) {
+        ui->RootTable->setItem(i, 0, new QTableWidgetItem(
+                                         QString::number(poly.Roots[i].real(), 'f', std::max(5, tol))));
+        ui->RootTable->setItem(i, 1, new QTableWidgetItem(
+                                         QString::number(poly.Roots[i].imag(), 'f', std::max(5, tol))));
+    }
+    ui->RootTable->horizontalHeader()->setStretchLastSection(true);
+
+    std::ostringstream info;
+    info << "Polynomial of degree " << poly.Degree << ": Aberth-Ehrlich on all roots\n"
+         << "Real roots: " << poly.RealCount << "\n"
+         << "Sweeps: " << poly.Iterations << (poly.Converged ? "" : " (not converged)") << "\n"
+         << "Time: " << elapsed << " ms\n";
+    ui->RootInfo->setPlainText(QString::fromStdString(info.str()));
+}
+
 /////////////////////////////////////////////////////////////////////////// Interpolation //////////////////////////////////////////////////////////////
 
 void MainWindow::on_TablePoints_valueChanged(int points)
@@ -279,11 +427,16 @@ void MainWindow::on_InterpolationSolveButton_clicked()
     QTableWidget *outTable = ui->InterpolAnsTable;
     symbol sym("x");
     InterpolationResult result;
+    const bool symbolic = ui->InterpolSymbolicCheck->isChecked();
 
     // 7. Dispatch to the chosen interpolation method
     switch (methodIndex) {
     case 1:  // Lagrange
-        result = InterpolSolver.lagrange(x_vals, y_vals, X, sym);
+        result = InterpolSolver.lagrange(x_vals, y_vals, X, sym, symbolic);
+        if (!result.Barycentric->valid()) {
+            QMessageBox::warning(this, "Invalid Data", "The x values must be distinct!");
+            return;
+        }
 
         // Setup 3 columns: basis name, symbolic expr, numeric value
         outTable->setColumnCount(3);
@@ -294,9 +447,10 @@ void MainWindow::on_InterpolationSolveButton_clicked()
             // Lᵢ label
             outTable->setItem(i, 0, new QTableWidgetItem(
                                         QString("L%1").arg(i)));
-            // symbolic expression
+            // symbolic expression, when asked for
             std::ostringstream oss;
-            oss << basis.first.expand();
+            if (symbolic)
+                oss << basis.first.expand();
             outTable->setItem(i, 1, new QTableWidgetItem(
                                         QString::fromStdString(oss.str())));
             // numeric value at X
@@ -306,61 +460,63 @@ void MainWindow::on_InterpolationSolveButton_clicked()
         break;
 
     case 2:  // Newton Forward
-        result = InterpolSolver.newtonForward(x_vals, y_vals, X, sym);
+    case 3:  // Newton Backward
+        result = methodIndex == 2 ? InterpolSolver.newtonForward(x_vals, y_vals, X, sym, symbolic)
+                                  : InterpolSolver.newtonBackward(x_vals, y_vals, X, sym, symbolic);
+        if (result.Differences->size() != x_vals.size()) {
+            QMessageBox::warning(this, "Invalid Data", "The x values must be distinct!");
+            return;
+        }
 
         // Build difference table header: x, y, Δ¹, Δ², …
         {
-            int levels = result.D.size();
+            const DividedDifferences &D = *result.Differences;
+            const int n = static_cast<int>(D.size());
             QStringList hdr = {"x", "y"};
-            for (int lev = 1; lev < levels; ++lev)
+            for (int lev = 1; lev < n; ++lev)
                 hdr << QString("Δ%1").arg(lev);
             outTable->setColumnCount(hdr.size());
             outTable->setHorizontalHeaderLabels(hdr);
-            outTable->setRowCount(x_vals.size());
-
-            // Pack x, y, then each Δ-level
-            std::vector<std::vector<double>> tableData;
-            tableData.push_back(x_vals);
-            tableData.push_back(y_vals);
-            for (auto &Dlev : result.D) tableData.push_back(Dlev);
-
-            // Fill the widget
-            for (int col = 0; col < static_cast<int>(tableData.size()); ++col) {
-                for (int row = 0; row < static_cast<int>(tableData[col].size()); ++row) {
-                    outTable->setItem(row, col, new QTableWidgetItem(
-                                                    QString::number(tableData[col][row])));
+            outTable->setRowCount(n);
+
+            for (int row = 0; row < n; ++row)
+                outTable->setItem(row, 0, new QTableWidgetItem(QString::number(x_vals[row])));
+
+            // Column 1 + k holds the order-k differences. Forward aligns
+            // them at the top; backward shifts them so the last entries
+            // line up at the bottom.
+            for (int k = 0; k < n; ++k) {
+                const int len = n - k;
+                for (int i = 0; i < len; ++i) {
+                    const int row = methodIndex == 2 ? i : n - len + i;
+                    outTable->setItem(row, 1 + k, new QTableWidgetItem(
+                                                      QString::number(D.at(k, i))));
                 }
             }
         }
         break;
 
-    case 3:  // Newton Backward
-        result = InterpolSolver.newtonBackward(x_vals, y_vals, X, sym);
+    case 4:  // Cubic spline, natural
+    case 5:  // Cubic spline, not-a-knot
+        result = InterpolSolver.spline(x_vals, y_vals, X, sym,
+                                       methodIndex == 4 ? SplineBoundary::Natural : SplineBoundary::NotAKnot, symbolic);
+        if (!result.Spline->valid()) {
+            QMessageBox::warning(this, "Invalid Data", "The x values must be distinct!");
+            return;
+        }
 
-        // Similar to forward but align bottom-up
+        // One row per piece: its interval and a, b, c, d
         {
-            int levels = result.D.size();
-            QStringList hdr = {"x", "y"};
-            for (int lev = 1; lev < levels; ++lev)
-                hdr << QString("Δ%1").arg(lev);
-            outTable->setColumnCount(hdr.size());
-            outTable->setHorizontalHeaderLabels(hdr);
-            outTable->setRowCount(x_vals.size());
-
-            std::vector<std::vector<double>> tableData;
-            tableData.push_back(x_vals);
-            tableData.push_back(y_vals);
-            for (auto &Dlev : result.D) tableData.push_back(Dlev);
-
-            // For backward, rows shift so last entries align
-            int n = x_vals.size();
-            for (int col = 0; col < static_cast<int>(tableData.size()); ++col) {
-                int len = tableData[col].size();
-                for (int i = 0; i < len; ++i) {
-                    int row = n - len + i;
-                    outTable->setItem(row, col, new QTableWidgetItem(
-                                                    QString::number(tableData[col][i])));
-                }
+            const CubicSpline &S = *result.Spline;
+            const int pieces = static_cast<int>(S.knots()) - 1;
+            outTable->setColumnCount(6);
+            outTable->setHorizontalHeaderLabels({"From", "To", "a", "b", "c", "d"});
+            outTable->setRowCount(pieces);
+            for (int i = 0; i < pieces; ++i) {
+                outTable->setItem(i, 0, new QTableWidgetItem(QString::number(S.nodes()[i])));
+                outTable->setItem(i, 1, new QTableWidgetItem(QString::number(S.nodes()[i + 1])));
+                for (int k = 0; k < 4; ++k)
+                    outTable->setItem(i, 2 + k, new QTableWidgetItem(QString::number(S.piece(i)[k])));
             }
         }
         break;
@@ -376,10 +532,11 @@ void MainWindow::on_InterpolationSolveButton_clicked()
     std::ostringstream info;
     if (methodIndex == 1)       info << "Method: Lagrange\n\n";
     else if (methodIndex == 2)  info << "Method: Newton Forward\n\n";
-    else                         info << "Method: Newton Backward\n\n";
+    else if (methodIndex == 3)  info << "Method: Newton Backward\n\n";
+    else                         info << "Method: " << ui->InterpolationMethodSelector->currentText().toStdString() << "\n\n";
 
     // Hint on best variant if using Newton
-    if (methodIndex > 1) {
+    if (methodIndex == 2 || methodIndex == 3) {
         double mid = 0.5*(x_min + x_max);
         info << "Best around X=" << X << ": "
              << ((X < mid) ? "Forward" : (X > mid) ? "Backward" : "Either")
@@ -387,7 +544,23 @@ void MainWindow::on_InterpolationSolveButton_clicked()
     }
 
     // Show the polynomial itself
-    info << "P(x) = " << result.P.first.expand();
+    if (methodIndex == 1)
+        info << "Barycentric weights: " << result.Barycentric->size() << " (O(n) per evaluation)\n\n";
+    if (methodIndex == 2 || methodIndex == 3)
+        info << "Newton form: " << result.Polynomial->coefficients().size() << " coefficients (Horner, O(n) per evaluation)\n\n";
+    if (methodIndex >= 4) {
+        const size_t piece = result.Spline->locate(X);
+        info << "Knots: " << result.Spline->knots() << (result.Spline->uniform() ? " (uniform: O(1) lookup)" : "") << "\n";
+        info << "Piece used: [" << result.Spline->nodes()[piece] << ", " << result.Spline->nodes()[piece + 1] << "]\n\n";
+        if (symbolic)
+            info << "S(x) = " << result.P.first.expand() << " on that piece";
+        else
+            info << "S(x) not built (Show polynomial is off)";
+    }
+    else if (symbolic)
+        info << "P(x) = " << result.P.first.expand();
+    else
+        info << "P(x) not built (Show polynomial is off)";
     ui->InterpolationInfo->setPlainText(QString::fromStdString(info.str()));
 }
 
@@ -432,29 +605,118 @@ void MainWindow::on_IntSolveButton_clicked()
 
     // 2. Parse equation
     const std::string eqString = eqText.toStdString();
-    symbol x("x");
-    parser p = RootSolver.make_full_parser(x);
-    ex fx;
+    ExpressionHandle fx;
+
+    // Cubature and quasi-Monte Carlo integrate over x, y and z as far as F
+    // uses them; the other methods only know x.
+    const bool multidimensional = methodIndex == 8 || methodIndex == 9;
+    IntegrationBox box;
 
     try {
-        fx = p(eqString);
+        if (multidimensional) {
+            fx = ExpressionRegistry::instance().get(eqString, {"x", "y", "z"});
+            const size_t dims = fx->expr().has(fx->variable(2)) ? 3 : fx->expr().has(fx->variable(1)) ? 2 : 1;
+            const std::vector<std::string> names = {"x", "y", "z"};
+            fx = ExpressionRegistry::instance().get(eqString, std::vector<std::string>(names.begin(), names.begin() + dims));
+
+            box.emplace_back(a, b);
+            box.emplace_back(ui->LowerYInput->value(), ui->UpperYInput->value());
+            box.emplace_back(ui->LowerZInput->value(), ui->UpperZInput->value());
+            box.resize(dims);
+        }
+        else
+            fx = ExpressionRegistry::instance().get(eqString);
     }
     catch (const std::exception&) {
         QMessageBox::warning(this, "Unsupported", "Wrong or unsupported equation!");
         return;
     }
+    statusBar()->showMessage(registrySummary());
+
+    for (const std::pair<double, double> &side : box) {
+        if (side.first >= side.second) {
+            QMessageBox::warning(this, "Invalid Input", "Lower Bound should be less than Upper Bound for y and z too!  ");
+            return;
+        }
+    }
+
+    // The cached evaluator is shared; native mode works on a private copy.
+    CompiledFunction f = fx->function();
+    NativeReport native;
+    if (ui->IntNativeCheck->isChecked())
+        native = f.enableNative();
+
+    // The node table costs 16 bytes and a table cell per step; past this,
+    // only streaming mode is reasonable.
+    const int maxTableSteps = 1000000;
+    const bool streaming = ui->IntStreamCheck->isChecked() && methodIndex <= 3;
+    // Gauss-Legendre puts 20 nodes in each of the n panels.
+    const int gaussOrder = 20;
+    const long long tableSteps = methodIndex == 6 ? static_cast<long long>(n) * gaussOrder : n;
+    if (!streaming && methodIndex != 4 && methodIndex < 7 && tableSteps > maxTableSteps) {
+        QMessageBox::warning(this, "Too Many Steps",
+                             "Use streaming mode for more than " + QString::number(maxTableSteps) + " steps!  ");
+        return;
+    }
 
     IntegrationResult Result;
 
-    switch (methodIndex) {
+    if (streaming) {
+        const NewtonCotes rule = methodIndex == 1 ? NewtonCotes::Trapezoidal
+                                 : methodIndex == 2 ? NewtonCotes::SimpsonOneThird
+                                                    : NewtonCotes::SimpsonThreeEighth;
+        Result = IntegrSolver.streaming(f, a, b, n, rule, Summation::Neumaier, 200);
+    }
+    else switch (methodIndex) {
     case 1:
-        Result = IntegrSolver.trapezoidal(fx, x, a, b, n);
+        Result = IntegrSolver.trapezoidal(f, a, b, n);
         break;
     case 2:
-        Result = IntegrSolver.simpsonOneThird(fx, x, a, b, n);
+        Result = IntegrSolver.simpsonOneThird(f, a, b, n);
         break;
     case 3:
-        Result = IntegrSolver.simpsonThreeEighth(fx, x, a, b, n);
+        Result = IntegrSolver.simpsonThreeEighth(f, a, b, n);
+        break;
+    case 4: {
+        const double tol = std::pow(10.0, -ui->IntTolInput->value());
+        Result = IntegrSolver.gaussKronrod(f, a, b, tol, tol);
+        break;
+    }
+    case 5: {
+        const double tol = std::pow(10.0, -ui->IntTolInput->value());
+        // Level k evaluates n 2^k nodes; refine only while that stays
+        // within the table limit, or a rough f would never stop.
+        int levels = 0;
+        while (levels < 16 && (static_cast<long long>(n) << (levels + 1)) <= maxTableSteps)
+            ++levels;
+        Result = IntegrSolver.romberg(f, a, b, n, tol, tol, levels);
+        break;
+    }
+    case 6:
+        Result = IntegrSolver.gaussLegendre(f, a, b, n, gaussOrder);
+        break;
+    case 7: {
+        const double tol = std::pow(10.0, -ui->IntTolInput->value());
+        Result = IntegrSolver.tanhSinh(f, a, b, tol, tol);
+        break;
+    }
+    case 8: {
+        const double tol = std::pow(10.0, -ui->IntTolInput->value());
+        Result = IntegrSolver.cubature(f, box, tol, tol);
+        break;
+    }
+    case 9: {
+        const double tol = std::pow(10.0, -ui->IntTolInput->value());
+        Result = IntegrSolver.quasiMonteCarlo(f, box, tol, tol);
+        break;
+    }
+    case 10: {
+        // Relative cutoff on the coefficients; at most 4096 + 1 nodes so
+        // the table stays usable when F is not smooth.
+        const double tol = std::pow(10.0, -ui->IntTolInput->value());
+        Result = IntegrSolver.clenshawCurtis(f, a, b, tol, 4096);
+        break;
+    }
     default:
         break;
     }
@@ -462,46 +724,274 @@ void MainWindow::on_IntSolveButton_clicked()
     QTableWidget *table = ui->IntTable;
     table->clearContents();
 
-    // 2 rows: one for x, one for f(x)
-    int m = static_cast<int>(Result.X.size());
-    table->setRowCount(2);
-    table->setColumnCount(m);
+    if (methodIndex == 5) {
+        // Romberg: the tableau, one row per level (n * 2^k intervals)
+        const int levels = static_cast<int>(Result.Tableau.size());
+        table->setRowCount(levels);
+        table->setColumnCount(levels);
+        QStringList rowLabels, colLabels;
+        for (int k = 0; k < levels; ++k) {
+            rowLabels << "n=" + QString::number(static_cast<long long>(n) << k);
+            colLabels << "R(k," + QString::number(k) + ")";
+            for (int j = 0; j <= k; ++j)
+                table->setItem(k, j, new QTableWidgetItem(QString::number(Result.Tableau[k][j], 'g', 12)));
+        }
+        table->setVerticalHeaderLabels(rowLabels);
+        table->setHorizontalHeaderLabels(colLabels);
+    } else if (multidimensional) {
+        // One row per refinement: points, estimate, error estimate
+        const int levels = static_cast<int>(Result.Levels.size());
+        table->setRowCount(levels);
+        table->setColumnCount(3);
+        table->setHorizontalHeaderLabels({ "Points", "Integral", "Error estimate" });
+        QStringList rowLabels;
+        for (int k = 0; k < levels; ++k) {
+            const CubatureLevel &level = Result.Levels[k];
+            rowLabels << QString::number(k + 1);
+            table->setItem(k, 0, new QTableWidgetItem(QString::number(level.Points)));
+            table->setItem(k, 1, new QTableWidgetItem(QString::number(level.I, 'g', 12)));
+            table->setItem(k, 2, new QTableWidgetItem(QString::number(level.Error, 'g', 3)));
+        }
+        table->setVerticalHeaderLabels(rowLabels);
+    } else {
+        // 2 rows: one for x, one for f(x)
+        int m = static_cast<int>(Result.X.size());
+        table->setRowCount(2);
+        table->setColumnCount(m);
+
+        // Label the rows “x” and “f(x)”
+        table->setVerticalHeaderLabels({ "x", "f(x)" });
+
+        // (Optionally) label each column by its index or x-value
+        QStringList colLabels;
+        colLabels.reserve(m);
+        for (int j = 0; j < m; ++j) {
+            // e.g. label by index:
+            colLabels << QString::number(j);
+            // or if you prefer to show the x-value as header:
+            // colLabels << QString::number(Result.X[j], 'g', 6);
+        }
+        table->setHorizontalHeaderLabels(colLabels);
+
+        // Fill row 0 with all the x’s, row 1 with all the f(x)’s
+        for (int j = 0; j < m; ++j) {
+            table->setItem(0, j, new QTableWidgetItem(QString::number(Result.X[j])));
+            table->setItem(1, j, new QTableWidgetItem(QString::number(Result.FX[j])));
+        }
+    }
+
+    // Stretch so it fills the width nicely
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    table->verticalHeader()  ->setSectionResizeMode(QHeaderView::ResizeToContents);
 
-    // Label the rows “x” and “f(x)”
-    table->setVerticalHeaderLabels({ "x", "f(x)" });
+    ui->IntLabel->setText(QString::number(Result.I, 'g', 10));
 
-    // (Optionally) label each column by its index or x-value
+    // 6. Show summary info
+    QString info;
+    info += "Method: " + ui->MethodSelector->currentText() + "\n";
+    if (methodIndex == 4)
+        info += "Subintervals: " + QString::number(Result.X.size() / 15) + "\n";
+    else if (methodIndex == 6)
+        info += "Panels: " + QString::number(n) + " x " + QString::number(gaussOrder) + " nodes\n";
+    else if (methodIndex == 7 || methodIndex == 10)
+        info += "Nodes: " + QString::number(Result.X.size()) + "\n";
+    else if (multidimensional)
+        info += "Variables: " + QString::number(box.size()) + "\n";
+    else
+        info += "Intervals (n): " + QString::number(n) + "\n";
+    if (methodIndex == 7)
+        info += "Step in t: " + QString::number(Result.h, 'g', 10) + "\n";
+    else if (multidimensional) {
+        if (methodIndex == 9)
+            info += "Randomizations: 8 (error = standard error of their mean)\n";
+        info += "Threads: " + QString::number(ThreadPool::instance().size()) + "\n";
+    }
+    else if (methodIndex != 10)
+        info += "Step size (h): " + QString::number(Result.h, 'g', 10) + "\n";
+    info += "Integral ≈ " + QString::number(Result.I, 'g', 10) + "\n";
+    if (!std::isnan(Result.Error))
+        info += "Error estimate: " + QString::number(Result.Error, 'g', 3) + "\n";
+    info += "Function evaluations: " + QString::number(Result.Evaluations) + "\n";
+    if (streaming) {
+        info += "Streaming: Neumaier summation, table shows " + QString::number(Result.X.size())
+                + " of " + QString::number(Result.Evaluations) + " nodes\n";
+        info += "Threads: " + QString::number(ThreadPool::instance().size()) + "\n";
+    }
+    if (methodIndex == 5) {
+        // What rerunning the trapezoidal rule at every level would cost
+        long long naive = 0;
+        for (size_t k = 0; k < Result.Tableau.size(); ++k)
+            naive += (static_cast<long long>(n) << k) + 1;
+        info += "Levels: " + QString::number(Result.Tableau.size())
+                + " (trapezoidal reruns: " + QString::number(naive) + " evaluations)\n";
+    }
+
+    if (ui->IntNativeCheck->isChecked())
+        info += nativeSummary(native);
+    ui->IntInfo->setPlainText(info);
+}
+
+void MainWindow::on_IntBenchButton_clicked()
+{
+    const QString eqText = ui->IntEQInput->text();
+    if (eqText.isEmpty()) {
+        QMessageBox::warning(this, "Empty Equation", "Please enter F(x)!");
+        return;
+    }
+    const double a = ui->LowerBoundInput->value();
+    const double b = ui->UpperBoundInput->value();
+    if (a >= b) {
+        QMessageBox::warning(this, "Invalid Input", "Lower Bound should be less than Upper Bound!  ");
+        return;
+    }
+
+    ExpressionHandle fx;
+    try {
+        fx = ExpressionRegistry::instance().get(eqText.toStdString());
+    }
+    catch (const std::exception&) {
+        QMessageBox::warning(this, "Unsupported", "Wrong or unsupported equation!");
+        return;
+    }
+    statusBar()->showMessage(registrySummary());
+
+    // Added below whatever the last solve printed.
+    EvaluationBenchmark bench = CompiledFunction::benchmark(fx->expr(), fx->variable(), a, b);
+    QString info;
+    info += "Benchmark on [" + QString::number(a) + ", " + QString::number(b) + "]:\n";
+    info += "Evaluations/s (subs): " + QString::number(bench.SymbolicPerSecond, 'g', 4) + "\n";
+    info += "Evaluations/s (tape): " + QString::number(bench.CompiledPerSecond, 'g', 4) + "\n";
+    info += "Evaluations/s (batch, " + QString(simdTarget()) + "): " + QString::number(bench.BatchPerSecond, 'g', 4);
+
+    // For the streaming rules, also time the same rule on 1..N threads, on
+    // at most 2e6 intervals. Without a tape f runs serially through GiNaC,
+    // so there is nothing to scale.
+    const int methodIndex = ui->IntMethodSelector->currentIndex();
+    const long long scalingSteps = std::min<long long>(ui->StepsInput->value(), 2000000) / 6 * 6;
+    if (methodIndex >= 1 && methodIndex <= 3 && scalingSteps > 0) {
+        CompiledFunction f = fx->function();
+        if (ui->IntNativeCheck->isChecked())
+            f.enableNative();
+        if (!f.isCompiled()) {
+            info += "\nScaling: skipped, F(x) has no tape";
+        } else {
+            const NewtonCotes rule = methodIndex == 1 ? NewtonCotes::Trapezoidal
+                                     : methodIndex == 2 ? NewtonCotes::SimpsonOneThird
+                                                        : NewtonCotes::SimpsonThreeEighth;
+            const std::vector<ScalingPoint> scaling = IntegrationMethods::streamingScaling(
+                f, a, b, scalingSteps, rule, ThreadPool::instance().size());
+            info += "\nStreaming scaling (" + QString::number(scalingSteps) + " steps):";
+            for (const ScalingPoint &p : scaling)
+                info += "\n  " + QString::number(p.Threads) + " threads: "
+                        + QString::number(p.Seconds * 1e3, 'f', 1) + " ms, speedup "
+                        + QString::number(scaling.front().Seconds / p.Seconds, 'f', 2);
+        }
+    }
+    ui->IntInfo->append(info);
+}
+
+void MainWindow::on_IntFileButton_clicked()
+{
+    const int methodIndex = ui->IntMethodSelector->currentIndex();
+    if (methodIndex != 1 && methodIndex != 2) {
+        QMessageBox::warning(this, "Unsupported Method", "Sample data uses Trapezoidal or Simpson 1/3!  ");
+        return;
+    }
+
+    const QString path = QFileDialog::getOpenFileName(this, "Integrate sample data", QString(),
+                                                      "Samples (*.csv *.txt *.dat *.bin *.f64);;All files (*)");
+    if (path.isEmpty())
+        return;
+
+    // .bin/.f64: raw float64 (x, y) pairs; anything else is read as CSV.
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    const SampleFormat format = suffix == "bin" || suffix == "f64" ? SampleFormat::Binary : SampleFormat::Csv;
+    const NewtonCotes rule = methodIndex == 1 ? NewtonCotes::Trapezoidal : NewtonCotes::SimpsonOneThird;
+
+    // Keep about 200 cumulative points for the table, whatever the file
+    // size: when the buffer fills, drop every other point and halve the rate.
+    std::vector<std::pair<double, double>> kept;
+    std::pair<double, double> lastPoint(NAN, NAN);
+    long long seen = 0, stride = 1;
+    auto keep = [&](double x, double c) {
+        if (seen++ % stride == 0) {
+            kept.emplace_back(x, c);
+            if (kept.size() == 400) {
+                for (size_t i = 0; i < 200; ++i)
+                    kept[i] = kept[2 * i];
+                kept.resize(200);
+                stride *= 2;
+            }
+        }
+        lastPoint = {x, c};
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+    const IntegrationResult Result = IntegrSolver.integrateFile(path.toStdString(), format, rule, keep);
+    const qint64 elapsed = timer.elapsed();
+
+    if (std::isnan(Result.I)) {
+        QMessageBox::warning(this, "Invalid Data",
+                             "Could not integrate the file: it needs at least two samples with increasing x!  ");
+        return;
+    }
+    if (kept.empty() || kept.back().first != lastPoint.first)
+        kept.push_back(lastPoint);
+
+    QTableWidget *table = ui->IntTable;
+    table->clearContents();
+    const int m = static_cast<int>(kept.size());
+    table->setRowCount(2);
+    table->setColumnCount(m);
+    table->setVerticalHeaderLabels({ "x", "cumulative" });
     QStringList colLabels;
-    colLabels.reserve(m);
     for (int j = 0; j < m; ++j) {
-        // e.g. label by index:
         colLabels << QString::number(j);
-        // or if you prefer to show the x-value as header:
-        // colLabels << QString::number(Result.X[j], 'g', 6);
+        table->setItem(0, j, new QTableWidgetItem(QString::number(kept[j].first)));
+        table->setItem(1, j, new QTableWidgetItem(QString::number(kept[j].second, 'g', 10)));
     }
     table->setHorizontalHeaderLabels(colLabels);
-
-    // Fill row 0 with all the x’s, row 1 with all the f(x)’s
-    for (int j = 0; j < m; ++j) {
-        table->setItem(0, j, new QTableWidgetItem(QString::number(Result.X[j])));
-        table->setItem(1, j, new QTableWidgetItem(QString::number(Result.FX[j])));
-    }
-
-    // Stretch so it fills the width nicely
     table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
     table->verticalHeader()  ->setSectionResizeMode(QHeaderView::ResizeToContents);
 
     ui->IntLabel->setText(QString::number(Result.I, 'g', 10));
 
-    // 6. Show summary info
     QString info;
-    info += "Method: " + ui->MethodSelector->currentText() + "\n";
-    info += "Intervals (n): " + QString::number(n) + "\n";
-    info += "Step size (h): " + QString::number(Result.h, 'g', 10) + "\n";
+    info += "Method: " + ui->IntMethodSelector->currentText() + " on samples\n";
+    info += "File: " + path + (format == SampleFormat::Binary ? " (binary)" : " (CSV)") + "\n";
+    info += "Samples: " + QString::number(Result.Evaluations) + "\n";
     info += "Integral ≈ " + QString::number(Result.I, 'g', 10) + "\n";
+    info += "Read and integrated in " + QString::number(elapsed) + " ms (memory-mapped)\n";
+    info += "Table shows " + QString::number(m) + " points of the cumulative integral\n";
     ui->IntInfo->setPlainText(info);
 }
 
+static QString nativeSummary(const NativeReport &report)
+{
+    if (!report.Loaded)
+        return "\nNative: unavailable (" + QString::fromStdString(report.Message) + "), using tape\n";
+
+    QString info = "\nNative: " + QString(report.CacheHit ? "cached" : "compiled")
+                   + " in " + QString::number(report.CompileSeconds * 1e3, 'g', 4) + " ms\n";
+    info += "Per call: " + QString::number(report.NativeCallNs, 'g', 3) + " ns native, "
+            + QString::number(report.TapeCallNs, 'g', 3) + " ns tape\n";
+
+    const double saved = report.TapeCallNs - report.NativeCallNs;
+    if (saved > 0)
+        info += "Break-even: " + QString::number(report.CompileSeconds * 1e9 / saved, 'g', 3) + " calls\n";
+    return info;
+}
+
+static QString registrySummary()
+{
+    const RegistryStats stats = ExpressionRegistry::instance().stats();
+    return "Expression cache: " + QString::number(stats.Hits) + " hits / "
+           + QString::number(stats.Hits + stats.Misses) + " lookups ("
+           + QString::number(100 * stats.hitRate(), 'f', 1) + "%), "
+           + QString::number(stats.Size) + "/" + QString::number(stats.Capacity) + " entries";
+}
+
 void MainWindow::on_StepsInput_valueChanged(int steps)
 {
     ui->IntMethodSelector->setCurrentIndex(0);
@@ -524,7 +1014,8 @@ void MainWindow::on_X_eq_option_clicked(bool checked)
 void MainWindow::on_X_range_clicked(bool checked)
 {
     ui->X_eq_input->setEnabled(!checked);
-    if(ui->EulerMethodSelector->currentIndex() == 2){
+    // Modified Euler and RK4 only report up to the end of the range.
+    if(ui->EulerMethodSelector->currentIndex() == 2 || ui->EulerMethodSelector->currentIndex() == 3){
         ui->X_range_low->setEnabled(!checked);
         ui->X_range_low->setValue(ui->X0Input->value());
     }
@@ -557,18 +1048,15 @@ void MainWindow::on_EulerSolveButton_clicked()
 
     // 2. Parse equation
     const std::string eqString = eqText.toStdString();
-    symbol x("x"), y("y");
-    parser p;
-    p.get_syms()["x"] = x;
-    p.get_syms()["y"] = y;
-    ex fxy;
+    ExpressionHandle fxy;
     try {
-        fxy = p(eqString);
+        fxy = ExpressionRegistry::instance().get(eqString, {"x", "y"});
     }
     catch (const std::exception&) {
         QMessageBox::warning(this, "Unsupported", "Wrong or unsupported equation!");
         return;
     }
+    statusBar()->showMessage(registrySummary());
 
     // 3. Get initial conditions
     double x0 = ui->X0Input->value();
@@ -576,6 +1064,11 @@ void MainWindow::on_EulerSolveButton_clicked()
     double h = ui->EulerStepsInput->value(); // Step size will be calculated later
     EulerResult result;
 
+    CompiledFunction f = fxy->function();
+    NativeReport native;
+    if (ui->EulerNativeCheck->isChecked())
+        native = f.enableNative();
+
 
     // 6. Display results in the UI
     QTableWidget *table = ui->EulerResultsTable;
@@ -586,11 +1079,11 @@ void MainWindow::on_EulerSolveButton_clicked()
 
         if (ui->X_eq_option->isChecked()) {
             double x_ = ui->X_eq_input->value();
-            result = EulerSolver.Euler(fxy, x, y, x0, y0, x_, h);
+            result = EulerSolver.Euler(f, x0, y0, x_, h);
         } else if (ui->X_range->isChecked()) {
             double xs = ui->X_range_low->value();
             double xe = ui->X_range_high->value();
-            result = EulerSolver.Euler(fxy, x, y, x0, y0, {xs, xe}, h);
+            result = EulerSolver.Euler(f, x0, y0, {xs, xe}, h);
 
         }
         table->setColumnCount(3); // Two rows for X and Y
@@ -612,6 +1105,9 @@ void MainWindow::on_EulerSolveButton_clicked()
         info += "Method: Euler \n";
         info += "Initial Condition: (x0, y0) = (" + QString::number(x0) + ", " + QString::number(y0) + ")\n";
         info += "Step Size (h): " + QString::number(h, 'g', 10) + "\n";
+        info += "f Evaluations: " + QString::number(result.Evaluations) + "\n";
+        if (ui->EulerNativeCheck->isChecked())
+            info += nativeSummary(native);
         ui->EulerInfo->setPlainText(info);
 
 
@@ -625,7 +1121,7 @@ void MainWindow::on_EulerSolveButton_clicked()
         } else if (ui->X_range->isChecked()) {
             x_ = ui->X_range_high->value();
         }
-        result = EulerSolver.ModifiedEuler(fxy, x, y, x0, y0, x_, h);
+        result = EulerSolver.ModifiedEuler(f, x0, y0, x_, h);
 
         table->setColumnCount(7); // Two rows for X and Y
         table->setRowCount(result.X.size());
@@ -651,6 +1147,120 @@ void MainWindow::on_EulerSolveButton_clicked()
         info += "Method: Modified Euler \n";
         info += "Initial Condition: (x0, y0) = (" + QString::number(x0) + ", " + QString::number(y0) + ")\n";
         info += "Step Size (h): " + QString::number(h, 'g', 10) + "\n";
+        info += "f Evaluations: " + QString::number(result.Evaluations) + "\n";
+        if (ui->EulerNativeCheck->isChecked())
+            info += nativeSummary(native);
+        ui->EulerInfo->setPlainText(info);
+    }
+
+    if (methodIndex == 3){
+
+        double x_ = x0;
+        if (ui->X_eq_option->isChecked()) {
+            x_ = ui->X_eq_input->value();
+        } else if (ui->X_range->isChecked()) {
+            x_ = ui->X_range_high->value();
+        }
+        if (x_ <= x0) {
+            QMessageBox::warning(this, "Invalid Range", "The end point must be greater than x0!");
+            return;
+        }
+        result = EulerSolver.RungeKutta4(f, x0, y0, x_, h);
+
+        table->setColumnCount(3);
+        table->setRowCount(result.X.size());
+        table->setHorizontalHeaderLabels({"X", "Y", "f(x, y)"});
+
+        for (int i = 0; i < result.X.size(); ++i) {
+            table->setItem(i, 0, new QTableWidgetItem(QString::number(result.X[i])));
+            table->setItem(i, 1, new QTableWidgetItem(QString::number(result.Y[i], 'g', 12)));
+            if(i < result.X.size() - 1)
+            table->setItem(i, 2, new QTableWidgetItem(QString::number(result.Fxy[i])));
+        }
+
+        QString info;
+        ui->EulerInfo->selectAll();
+        ui->EulerInfo->cut();
+
+        info += "Method: Runge-Kutta 4 \n";
+        info += "Initial Condition: (x0, y0) = (" + QString::number(x0) + ", " + QString::number(y0) + ")\n";
+        info += "Step Size (h): " + QString::number(h, 'g', 10) + "\n";
+        info += "Steps: " + QString::number(result.Accepted) + "\n";
+        info += "f Evaluations: " + QString::number(result.Evaluations) + "\n";
+        if (ui->EulerNativeCheck->isChecked())
+            info += nativeSummary(native);
+        ui->EulerInfo->setPlainText(info);
+    }
+
+    if (methodIndex == 4){
+
+        const double tol = std::pow(10.0, -ui->EulerTolInput->value());
+        // With a range, h is the spacing of the reported points; the steps
+        // themselves are chosen by the error control.
+        vector<double> at;
+        double x_ = x0;
+        if (ui->X_eq_option->isChecked()) {
+            x_ = ui->X_eq_input->value();
+        } else if (ui->X_range->isChecked()) {
+            const double xs = ui->X_range_low->value();
+            x_ = ui->X_range_high->value();
+            if (xs < x0 || xs > x_) {
+                QMessageBox::warning(this, "Invalid Range", "The range must lie between x0 and its end!");
+                return;
+            }
+            const long points = long((x_ - xs) / h + 1e-9) + 1;
+            for (long i = 0; i < points; ++i)
+                at.push_back(xs + i * h);
+            if (at.back() < x_)
+                at.push_back(x_);
+        }
+        if (x_ <= x0) {
+            QMessageBox::warning(this, "Invalid Range", "The end point must be greater than x0!");
+            return;
+        }
+        result = EulerSolver.DormandPrince(f, x0, y0, x_, tol, tol, at);
+
+        if (at.empty()) {
+            table->setColumnCount(4);
+            table->setRowCount(result.X.size());
+            table->setHorizontalHeaderLabels({"X", "Y", "h", "f(x, y)"});
+
+            for (int i = 0; i < result.X.size(); ++i) {
+                table->setItem(i, 0, new QTableWidgetItem(QString::number(result.X[i], 'g', 12)));
+                table->setItem(i, 1, new QTableWidgetItem(QString::number(result.Y[i], 'g', 12)));
+                if(i < result.X.size() - 1){
+                    table->setItem(i, 2, new QTableWidgetItem(QString::number(result.X[i+1] - result.X[i])));
+                    table->setItem(i, 3, new QTableWidgetItem(QString::number(result.Fxy[i])));
+                }
+            }
+        } else {
+            table->setColumnCount(2);
+            table->setRowCount(result.XDense.size());
+            table->setHorizontalHeaderLabels({"X", "Y"});
+
+            for (int i = 0; i < result.XDense.size(); ++i) {
+                table->setItem(i, 0, new QTableWidgetItem(QString::number(result.XDense[i])));
+                table->setItem(i, 1, new QTableWidgetItem(QString::number(result.YDense[i], 'g', 12)));
+            }
+        }
+
+        QString info;
+        ui->EulerInfo->selectAll();
+        ui->EulerInfo->cut();
+
+        info += "Method: Dormand-Prince RK45 \n";
+        info += "Initial Condition: (x0, y0) = (" + QString::number(x0) + ", " + QString::number(y0) + ")\n";
+        info += "Tolerance: " + QString::number(tol) + " (absolute and relative)\n";
+        info += "First Step (h): " + QString::number(result.h, 'g', 10) + "\n";
+        info += "Accepted Steps: " + QString::number(result.Accepted) + "\n";
+        info += "Rejected Steps: " + QString::number(result.Rejected) + "\n";
+        info += "f Evaluations: " + QString::number(result.Evaluations) + "\n";
+        if (!at.empty())
+            info += "Table: dense output at " + QString::number(at.size()) + " points, spacing " + QString::number(h) + "\n";
+        if (result.X.empty() || result.X.back() != x_)
+            info += "Stopped before the end point (f not finite or step too small).\n";
+        if (ui->EulerNativeCheck->isChecked())
+            info += nativeSummary(native);
         ui->EulerInfo->setPlainText(info);
     }
 
@@ -658,7 +1268,7 @@ void MainWindow::on_EulerSolveButton_clicked()
 
 void MainWindow::on_X0Input_valueChanged(double arg1)
 {
-    if(ui->EulerMethodSelector->currentIndex() == 2){
+    if(ui->EulerMethodSelector->currentIndex() == 2 || ui->EulerMethodSelector->currentIndex() == 3){
         if(ui->X_range->isChecked()){
             ui->X_range_low->setValue(arg1);
         }
@@ -789,14 +1399,10 @@ void MainWindow::on_CurveSolveButton_clicked()
     }
     qDebug() << "Custom Y done!\n";
 
-    ex c_x, c_y;
-    symbol x("x"), y("y");
-    parser px, py;
-    px.get_syms()["x"] = x;
-    py.get_syms()["y"] = y;
+    ExpressionHandle c_x, c_y;
 
     try{
-        c_x = px(CustomX.toStdString());
+        c_x = ExpressionRegistry::instance().get(CustomX.toStdString(), {"x"});
     }
     catch (const std::exception& e) {
         QMessageBox::warning(this, "Unsupported", "Wrong or unsupported equation in X   ");
@@ -804,7 +1410,7 @@ void MainWindow::on_CurveSolveButton_clicked()
     }
 
     try{
-        c_y = py(CustomY.toStdString());
+        c_y = ExpressionRegistry::instance().get(CustomY.toStdString(), {"y"});
     }
     catch (const std::exception& e) {
         QMessageBox::warning(this, "Unsupported", "Wrong or unsupported equation in Y");
@@ -812,6 +1418,7 @@ void MainWindow::on_CurveSolveButton_clicked()
 
     }
     qDebug() << "exp Done for X, Y!\n";
+    statusBar()->showMessage(registrySummary());
 
     ostringstream info;
 
@@ -820,7 +1427,7 @@ void MainWindow::on_CurveSolveButton_clicked()
     CurveResult result;
     if (methodIndex == 1) // y = ax + b
     {
-        result = CurveSolver.linear(c_x, c_y, x_vals, y_vals, x, y);
+        result = CurveSolver.linear(c_x, c_y, x_vals, y_vals);
         info << "Model: y = a·x + b\n";
         info << "Normal equations:\n";
         info << "  ∑y = a∑x + n·b\n";
@@ -828,7 +1435,7 @@ void MainWindow::on_CurveSolveButton_clicked()
     }
     else if (methodIndex == 2) // y = ax^2 + bx + c
     {
-        result = CurveSolver.quadric(c_x, c_y, x_vals, y_vals, x, y);
+        result = CurveSolver.quadric(c_x, c_y, x_vals, y_vals);
         info << "Model: y = a·x² + b·x + c\n";
         info << "Normal equations:\n";
         info << "  ∑y = a∑x² + b∑x + n·c\n";
@@ -837,7 +1444,7 @@ void MainWindow::on_CurveSolveButton_clicked()
     }
     else if (methodIndex == 3) // y = a e^(bx)
     {
-        result = CurveSolver.exponential(c_x, c_y, x_vals, y_vals, x, y);
+        result = CurveSolver.exponential(c_x, c_y, x_vals, y_vals);
         info << "Linearized model: ln(y) = ln(a) + b·x\n";
         info << "Linearized model: Y = A + b·x\n";
         info << "Normal equations:\n";
@@ -846,7 +1453,7 @@ void MainWindow::on_CurveSolveButton_clicked()
     }
     else if (methodIndex == 4) // y = a x^b
     {
-        result = CurveSolver.power1(c_x, c_y, x_vals, y_vals, x, y);
+        result = CurveSolver.power1(c_x, c_y, x_vals, y_vals);
         info << "Linearized model: ln(y) = ln(a) + b·ln(x)\n";
         info << "Linearized model: Y = A + b·X\n";
         info << "Normal equations:\n";
@@ -855,7 +1462,7 @@ void MainWindow::on_CurveSolveButton_clicked()
     }
     else if (methodIndex == 5) // y = b a^x
     {
-        result = CurveSolver.power2(c_x, c_y, x_vals, y_vals, x, y);
+        result = CurveSolver.power2(c_x, c_y, x_vals, y_vals);
         info << "Linearized model: ln(y) = ln(b) + x·ln(a)\n";
         info << "Linearized model: Y = B + x·A\n";
         info << "Normal equations:\n";
@@ -930,17 +1537,18 @@ void MainWindow::on_CurveSolveButton_clicked()
     if (isMethod2){
         info << "c = " << result.c << endl;
     }
+    const ex &cx = c_x->expr(), &cy = c_y->expr();
     ex form;
     if (methodIndex == 1){
-        form = c_y == result.a *(c_x) + result.b;
+        form = cy == result.a *(cx) + result.b;
     } else if (methodIndex == 2) {
-        form = c_y == result.a *pow(c_x, 2) + result.b * (c_x) + result.c;
+        form = cy == result.a *pow(cx, 2) + result.b * (cx) + result.c;
     } else if (methodIndex == 3){
-        form = c_y == result.a * exp(result.b * c_x);
+        form = cy == result.a * exp(result.b * cx);
     } else if (methodIndex == 4){
-        form = c_y == result.a * pow(c_x, result.b) ;
+        form = cy == result.a * pow(cx, result.b) ;
     }else if (methodIndex == 5){
-        form = c_y == result.b * pow(result.a,c_x);
+        form = cy == result.b * pow(result.a,cx);
     }
     info << "---------------------------------------------------\n\n";
     info << endl << "Final Formula:\n\n" << form.expand() << endl;
@@ -9,6 +9,8 @@
 #include "integrationmethods.h"
 #include "eulermethods.h"
 #include "curvefitting.h"
+#include "compiledfunction.h"
+#include "expressionregistry.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -44,6 +46,10 @@ private slots:
 
     void on_IntSolveButton_clicked();
 
+    void on_IntFileButton_clicked();
+
+    void on_IntBenchButton_clicked();
+
     void on_StepsInput_valueChanged(int steps);
 
     void on_X_eq_option_clicked(bool checked);
@@ -65,6 +71,9 @@ private slots:
     void on_CurveSolveButton_clicked();
 
 private:
+    void showAllRoots(const ExpressionHandle &fx, int methodIndex, double lo, double hi, int tol);
+    void showPolynomialRoots(const PolynomialRoots &poly, int tol, qint64 elapsed);
+
     Ui::MainWindow *ui;
 
     RootMethods RootSolver;
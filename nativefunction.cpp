@@ -0,0 +1,243 @@
+#include "nativefunction.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <spawn.h>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+static const char *CompilerFlags = "-O2 -fPIC -shared";
+
+static mutex CacheMutex;
+static map<string, NativeFunction::Kernel> LoadedKernels; // hash -> kernel
+
+static uint64_t fnv1a(const string &text)
+{
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : text) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// $CC split on blanks, so "ccache cc" works as it does in make.
+static vector<string> compilerCommand(const string &cc)
+{
+    vector<string> args;
+    istringstream words(cc);
+    for (string word; words >> word;)
+        args.push_back(word);
+    return args;
+}
+
+// Run args[0] (searched in PATH) with its output discarded. No shell is
+// involved, so paths need no quoting.
+static bool run(const vector<string> &args)
+{
+    if (args.empty())
+        return false;
+    vector<char *> argv;
+    for (const string &arg : args)
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+    pid_t pid;
+    const int spawned = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (spawned != 0)
+        return false;
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR)
+            return false;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// A file or directory only this user can have written: owned by us and
+// not group- or world-writable. Symlinks are not followed.
+static bool privateToUser(const string &path, bool directory)
+{
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0)
+        return false;
+    if (directory ? !S_ISDIR(st.st_mode) : !S_ISREG(st.st_mode))
+        return false;
+    return st.st_uid == geteuid() && (st.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
+
+const string &NativeFunction::compiler()
+{
+    static const string cc = [] {
+        const char *env = getenv("CC");
+        string candidate = (env && *env) ? env : "cc";
+        vector<string> probe = compilerCommand(candidate);
+        probe.push_back("--version");
+        return run(probe) ? candidate : string();
+    }();
+    return cc;
+}
+
+string NativeFunction::cacheDirectory()
+{
+    namespace fs = std::filesystem;
+    fs::path base;
+    if (const char *xdg = getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        base = xdg;
+    else if (const char *home = getenv("HOME"); home && *home)
+        base = fs::path(home) / ".cache";
+
+    if (!base.empty()) {
+        const fs::path dir = base / "numerical-analysis/jit";
+        error_code ec;
+        fs::create_directories(dir, ec);
+        chmod(dir.c_str(), 0700);
+        if (privateToUser(dir.string(), true))
+            return dir.string();
+    }
+
+    // No per-user cache: build in a fresh private directory for this
+    // process only, never in a shared, predictable path.
+    static const string scratch = [] {
+        string pattern = (fs::temp_directory_path() / "numerical-analysis-XXXXXX").string();
+        return mkdtemp(pattern.data()) ? pattern : string();
+    }();
+    return scratch;
+}
+
+string NativeFunction::source(const ex &f_expr, const vector<symbol> &vars)
+{
+    lst renames;
+    for (size_t i = 0; i < vars.size(); ++i)
+        renames.append(vars[i] == symbol("v" + to_string(i)));
+
+    ostringstream body;
+    f_expr.subs(renames).print(print_csrc_double(body));
+
+    ostringstream src;
+    src << "#include <math.h>\n\n"
+        << "static const double Pi = 3.14159265358979323846;\n"
+        << "static const double Euler = 0.57721566490153286061;\n"
+        << "static const double Catalan = 0.91596559417721890943;\n\n"
+        << "double na_kernel(const double *in)\n{\n";
+    for (size_t i = 0; i < vars.size(); ++i)
+        src << "    const double v" << i << " = in[" << i << "];\n";
+    src << "    return " << body.str() << ";\n}\n";
+    return src.str();
+}
+
+NativeFunction::Kernel NativeFunction::load(const ex &f_expr, const vector<symbol> &vars, NativeReport &report)
+{
+    namespace fs = std::filesystem;
+    using clock = chrono::steady_clock;
+    auto t0 = clock::now();
+
+    const string cc = compiler();
+    if (cc.empty()) {
+        report.Message = "no C compiler found";
+        return nullptr;
+    }
+
+    string code;
+    try {
+        code = source(f_expr, vars);
+    } catch (const exception &e) {
+        report.Message = string("code generation failed: ") + e.what();
+        return nullptr;
+    }
+
+    char key[17];
+    snprintf(key, sizeof key, "%016llx",
+             static_cast<unsigned long long>(fnv1a(code + cc + CompilerFlags)));
+
+    lock_guard<mutex> lock(CacheMutex);
+
+    auto it = LoadedKernels.find(key);
+    if (it != LoadedKernels.end()) {
+        report.Loaded = true;
+        report.CacheHit = true;
+        report.CompileSeconds = chrono::duration<double>(clock::now() - t0).count();
+        return it->second;
+    }
+
+    const string cacheDir = cacheDirectory();
+    if (cacheDir.empty()) {
+        report.Message = "no private directory for compiled code";
+        return nullptr;
+    }
+    const fs::path dir = cacheDir;
+    const fs::path so = dir / (string(key) + ".so");
+    // Only load what this user built; anything else is rebuilt over.
+    report.CacheHit = privateToUser(so.string(), false);
+
+    if (!report.CacheHit) {
+        // Both names are private to this process, so concurrent runs never
+        // write over each other's source or half-built library.
+        const string stem = string(key) + "." + to_string(getpid());
+        const fs::path src = dir / (stem + ".c");
+        const fs::path tmp = dir / (stem + ".so");
+        {
+            ofstream out(src);
+            out << code;
+        }
+
+        vector<string> cmd = compilerCommand(cc);
+        istringstream flags(CompilerFlags);
+        for (string flag; flags >> flag;)
+            cmd.push_back(flag);
+        cmd.insert(cmd.end(), {"-o", tmp.string(), src.string(), "-lm"});
+        const bool built = run(cmd);
+        error_code ec;
+        fs::remove(src, ec);
+        if (!built) {
+            report.Message = "compiler rejected generated code";
+            fs::remove(tmp, ec);
+            return nullptr;
+        }
+
+        // Rename is atomic, so a concurrent run never dlopens a partial file.
+        fs::rename(tmp, so, ec);
+        if (ec) {
+            report.Message = "could not write " + so.string();
+            fs::remove(tmp, ec);
+            return nullptr;
+        }
+    }
+
+    void *handle = dlopen(so.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        report.Message = string("dlopen failed: ") + dlerror();
+        return nullptr;
+    }
+
+    Kernel kernel = reinterpret_cast<Kernel>(dlsym(handle, "na_kernel"));
+    if (!kernel) {
+        report.Message = "na_kernel symbol missing";
+        dlclose(handle);
+        return nullptr;
+    }
+
+    LoadedKernels[key] = kernel;
+    report.Loaded = true;
+    report.CompileSeconds = chrono::duration<double>(clock::now() - t0).count();
+    return kernel;
+}
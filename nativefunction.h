@@ -0,0 +1,61 @@
+#ifndef NATIVEFUNCTION_H
+#define NATIVEFUNCTION_H
+
+#include <ginac/ginac.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace GiNaC;
+
+struct NativeReport
+{
+    bool Loaded = false;
+    bool CacheHit = false;        // shared object already built (this run or a previous one)
+    double CompileSeconds = 0;    // code generation + compiler + dlopen
+    double NativeCallNs = 0;      // mean latency per call
+    double TapeCallNs = 0;        // same measurement for the interpreted tape
+    string Message;               // why the native path was not taken
+};
+
+/**
+ * Compiles a GiNaC expression to machine code with the system C compiler.
+ *
+ * The expression is printed with print_csrc_double after renaming its
+ * variables to v0, v1, ..., so the C source is a normalized form of f and
+ * its hash keys an on-disk cache of shared objects
+ * ($XDG_CACHE_HOME/numerical-analysis/jit, mode 0700). A cached object is
+ * only loaded when it is a regular file owned by the current user and not
+ * group- or world-writable; without a per-user cache directory, objects
+ * go to a private temporary directory for this process. Handles are kept
+ * open for the lifetime of the process, so re-solving the same F(x) only
+ * costs a map lookup.
+ */
+class NativeFunction
+{
+public:
+    typedef double (*Kernel)(const double *vars);
+
+    /**
+     * Build (or fetch from cache) and load the kernel for f_expr.
+     *
+     * @param f_expr  Symbolic expression
+     * @param vars    Variables of f, in the order the kernel expects them
+     * @param report  Filled with load status and compile time
+     * @return        Kernel pointer, or nullptr when no compiler is available
+     *                or the generated code does not compile
+     */
+    static Kernel load(const ex &f_expr, const vector<symbol> &vars, NativeReport &report);
+
+    /**
+     * C compiler used for native kernels: $CC if set, otherwise "cc".
+     * Empty when no working compiler is found.
+     */
+    static const string &compiler();
+
+private:
+    static string source(const ex &f_expr, const vector<symbol> &vars);
+    static string cacheDirectory();
+};
+
+#endif // NATIVEFUNCTION_H
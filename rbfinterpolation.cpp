@@ -0,0 +1,396 @@
+#include "rbfinterpolation.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <random>
+
+static double wendland(RbfKernel kernel, double r)
+{
+    if (r >= 1)
+        return 0;
+    const double s = 1 - r, s2 = s * s;
+    if (kernel == RbfKernel::WendlandC4)
+        return s2 * s2 * s2 * (35 * r * r + 18 * r + 3) / 3;
+    return s2 * s2 * (4 * r + 1);
+}
+
+// Rows or queries per pool task.
+static const size_t RbfChunk = 4096;
+
+// Points per diagonal block of the preconditioner.
+static const size_t PreconditionerBlock = 16;
+
+// body(begin, end) over fixed chunks of [0, n).
+static void forChunks(size_t n, const std::function<void(size_t, size_t)> &body, size_t chunk = RbfChunk)
+{
+    const size_t chunks = (n + chunk - 1) / chunk;
+    auto run = [&](size_t c) { body(c * chunk, min(n, (c + 1) * chunk)); };
+    if (chunks > 1)
+        ThreadPool::instance().parallelFor(chunks, run);
+    else if (chunks == 1)
+        run(0);
+}
+
+// Chunk partial sums added in chunk order: the same on any thread count.
+static double dot(const vector<double> &a, const vector<double> &b)
+{
+    const size_t n = a.size();
+    vector<double> partial((n + RbfChunk - 1) / RbfChunk, 0);
+    forChunks(n, [&](size_t begin, size_t end) {
+        double s = 0;
+        for (size_t i = begin; i < end; ++i)
+            s += a[i] * b[i];
+        partial[begin / RbfChunk] = s;
+    });
+    double s = 0;
+    for (double p : partial)
+        s += p;
+    return s;
+}
+
+RbfInterpolant::RbfInterpolant(const vector<double> &points, const vector<double> &values, unsigned dimensions,
+                               RbfKernel kernel, double radius, size_t neighbours, int maxLevels,
+                               double tol, int maxIterations)
+    : RbfInterpolant(points.data(), values.data(),
+                     dimensions ? min(points.size() / dimensions, values.size()) : 0, dimensions,
+                     kernel, radius, neighbours, maxLevels, tol, maxIterations)
+{
+}
+
+RbfInterpolant::RbfInterpolant(const double *points, const double *values, size_t n, unsigned dimensions,
+                               RbfKernel kernel, double radius, size_t neighbours, int maxLevels,
+                               double tol, int maxIterations)
+    : Dimensions(dimensions), Kernel(kernel)
+{
+    if (dimensions < 1 || dimensions > MaxDimensions) {
+        cerr << "RBF interpolation supports 1 to " << MaxDimensions << " dimensions.\n";
+        return;
+    }
+    if (n == 0 || n > UINT32_MAX) {
+        cerr << "RBF interpolation needs between 1 and 2^32 - 1 points.\n";
+        return;
+    }
+    const unsigned d = dimensions;
+    neighbours = max<size_t>(neighbours, 2);
+
+    // Affine least-squares trend on centered coordinates: normal equations
+    // for (Offset, Slope[0..d-1]), solved by Gauss-Jordan elimination with
+    // partial pivoting. A direction with no spread of its own (all points
+    // on a line in 2-D, say) gets slope 0.
+    double lo[MaxDimensions], hi[MaxDimensions];
+    for (unsigned k = 0; k < d; ++k) {
+        lo[k] = hi[k] = points[k];
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const double v = points[i * d + k];
+            sum += v;
+            lo[k] = min(lo[k], v);
+            hi[k] = max(hi[k], v);
+        }
+        Center[k] = sum / n;
+    }
+    {
+        const unsigned m = d + 1;
+        double M[MaxDimensions + 1][MaxDimensions + 2] = {};
+        for (size_t i = 0; i < n; ++i) {
+            double u[MaxDimensions + 1] = {1};
+            for (unsigned k = 0; k < d; ++k)
+                u[k + 1] = points[i * d + k] - Center[k];
+            for (unsigned r = 0; r < m; ++r) {
+                for (unsigned c = 0; c < m; ++c)
+                    M[r][c] += u[r] * u[c];
+                M[r][m] += u[r] * values[i];
+            }
+        }
+        double solution[MaxDimensions + 1] = {}, scale[MaxDimensions + 1];
+        bool skip[MaxDimensions + 1] = {};
+        for (unsigned c = 0; c < m; ++c)
+            scale[c] = M[c][c];
+        for (unsigned c = 0; c < m; ++c) {
+            unsigned pivot = c;
+            for (unsigned r = c + 1; r < m; ++r)
+                if (fabs(M[r][c]) > fabs(M[pivot][c]))
+                    pivot = r;
+            if (fabs(M[pivot][c]) <= 1e-12 * scale[c]) {
+                skip[c] = true;
+                continue;
+            }
+            swap(M[pivot], M[c]);
+            for (unsigned r = 0; r < m; ++r) {
+                if (r == c || M[r][c] == 0)
+                    continue;
+                const double f = M[r][c] / M[c][c];
+                for (unsigned k = c; k <= m; ++k)
+                    M[r][k] -= f * M[c][k];
+            }
+        }
+        for (unsigned c = 0; c < m; ++c)
+            solution[c] = skip[c] ? 0 : M[c][m] / M[c][c];
+        Offset = solution[0];
+        for (unsigned k = 0; k < d; ++k)
+            Slope[k] = solution[k + 1];
+    }
+
+    // Finest support radius from the average density: a ball of radius r
+    // holds `neighbours` points when the box volume is shared out evenly.
+    // Flat directions (zero extent) are left out of the volume.
+    static const double UnitBall[MaxDimensions + 1] = {1, 2, M_PI, 4 * M_PI / 3};
+    double volume = 1;
+    unsigned spread = 0;
+    for (unsigned k = 0; k < d; ++k) {
+        if (hi[k] > lo[k]) {
+            volume *= hi[k] - lo[k];
+            ++spread;
+        }
+    }
+    if (radius <= 0)
+        radius = spread == 0 ? 1 : pow(double(neighbours) * volume / (n * UnitBall[spread]), 1.0 / spread);
+
+    // Level sizes, finest first: 2^spread times fewer points and twice the
+    // radius per level, down to a few supports' worth of points.
+    vector<size_t> sizes = {n};
+    const size_t ratio = size_t(1) << max(spread, 1u);
+    while (int(sizes.size()) < maxLevels && sizes.back() / ratio >= 8 * neighbours)
+        sizes.push_back(sizes.back() / ratio);
+    reverse(sizes.begin(), sizes.end());
+
+    // Nested subsets are prefixes of one shuffle (fixed seed, so the result
+    // is reproducible), which spreads every prefix over the whole domain
+    // whatever order the data came in.
+    vector<size_t> order(n);
+    for (size_t i = 0; i < n; ++i)
+        order[i] = i;
+    mt19937_64 random(0x5eed);
+    for (size_t i = n; i > 1; --i)
+        swap(order[i - 1], order[random() % i]);
+    vector<double> shuffled(n * d), residual(n);
+    for (size_t i = 0; i < n; ++i) {
+        copy(points + order[i] * d, points + (order[i] + 1) * d, &shuffled[i * d]);
+        residual[i] = values[order[i]] - trend(&shuffled[i * d]);
+    }
+
+    Converged = true;
+    for (size_t level = 0; level < sizes.size(); ++level) {
+        const double r = radius * pow(double(n) / sizes[level], 1.0 / max(spread, 1u));
+        if (!solveLevel(shuffled.data(), residual.data(), sizes[level], r, tol, maxIterations)) {
+            Grids.clear();
+            Levels.clear();
+            return;
+        }
+        Converged = Converged && Levels.back().Residual <= tol;
+        if (level + 1 == sizes.size())
+            break;
+        // What the finer levels still have to interpolate.
+        const Grid &grid = Grids.back();
+        forChunks(n, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                double s = 0;
+                grid.Tree.radius(&shuffled[i * d], grid.Radius, [&](size_t j, double d2) {
+                    s += grid.W[j] * wendland(Kernel, sqrt(d2) / grid.Radius);
+                });
+                residual[i] -= s;
+            }
+        });
+    }
+    Size = n;
+    Valid = true;
+}
+
+bool RbfInterpolant::solveLevel(const double *points, const double *rhs, size_t m, double radius,
+                                double tol, int maxIterations)
+{
+    Grid grid;
+    grid.Tree = KdTree(points, m, Dimensions);
+    grid.Radius = radius;
+    const KdTree &tree = grid.Tree;
+
+    // The system A w = b in tree order, as CSR: row i lists the points
+    // within the radius of point i. One parallel pass counts the rows and
+    // a second fills them in place, so the matrix is never held twice.
+    vector<size_t> rowStart(m + 1, 0);
+    atomic<bool> duplicate{false};
+    forChunks(m, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            size_t count = 0;
+            tree.radius(tree.point(i), radius, [&](size_t j, double d2) {
+                if (j != i && d2 == 0)
+                    duplicate = true;
+                ++count;
+            });
+            rowStart[i + 1] = count;
+        }
+    });
+    if (duplicate) {
+        cerr << "RBF interpolation points must be distinct.\n";
+        return false;
+    }
+    for (size_t i = 0; i < m; ++i)
+        rowStart[i + 1] += rowStart[i];
+
+    vector<uint32_t> column(rowStart[m]);
+    vector<double> entry(rowStart[m]);
+    forChunks(m, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            size_t e = rowStart[i];
+            tree.radius(tree.point(i), radius, [&](size_t j, double d2) {
+                column[e] = static_cast<uint32_t>(j);
+                entry[e] = wendland(Kernel, sqrt(d2) / radius);
+                ++e;
+            });
+        }
+    });
+
+    auto multiply = [&](const vector<double> &v, vector<double> &out) {
+        forChunks(m, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                double s = 0;
+                for (size_t e = rowStart[i]; e < rowStart[i + 1]; ++e)
+                    s += entry[e] * v[column[e]];
+                out[i] = s;
+            }
+        });
+    };
+
+    RbfLevel report = {m, radius, rowStart[m], 0, 0};
+
+    // Block-Jacobi preconditioner: the dense diagonal blocks of A over runs
+    // of consecutive tree positions, which are spatial neighbours, Cholesky
+    // factored. Points much closer together than the radius make A nearly
+    // singular, and such pairs mostly share a block, so this takes out the
+    // worst of the conditioning for a few doubles per point.
+    const size_t blocks = (m + PreconditionerBlock - 1) / PreconditionerBlock;
+    const size_t packed = PreconditionerBlock * (PreconditionerBlock + 1) / 2;
+    vector<double> factors(blocks * packed, 0);
+    forChunks(blocks, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b) {
+            const size_t first = b * PreconditionerBlock, size = min(PreconditionerBlock, m - first);
+            double *L = &factors[b * packed]; // row i at offset i(i+1)/2
+            for (size_t i = 0; i < size; ++i)
+                for (size_t e = rowStart[first + i]; e < rowStart[first + i + 1]; ++e)
+                    if (column[e] >= first && column[e] <= first + i)
+                        L[i * (i + 1) / 2 + column[e] - first] = entry[e];
+            for (size_t j = 0; j < size; ++j) {
+                double djj = L[j * (j + 1) / 2 + j];
+                for (size_t k = 0; k < j; ++k)
+                    djj -= L[j * (j + 1) / 2 + k] * L[j * (j + 1) / 2 + k];
+                djj = sqrt(max(djj, 1e-300));
+                L[j * (j + 1) / 2 + j] = djj;
+                for (size_t i = j + 1; i < size; ++i) {
+                    double lij = L[i * (i + 1) / 2 + j];
+                    for (size_t k = 0; k < j; ++k)
+                        lij -= L[i * (i + 1) / 2 + k] * L[j * (j + 1) / 2 + k];
+                    L[i * (i + 1) / 2 + j] = lij / djj;
+                }
+            }
+        }
+    }, 64);
+    auto precondition = [&](const vector<double> &v, vector<double> &out) {
+        forChunks(blocks, [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; ++b) {
+                const size_t first = b * PreconditionerBlock, size = min(PreconditionerBlock, m - first);
+                const double *L = &factors[b * packed];
+                double *z = &out[first];
+                for (size_t i = 0; i < size; ++i) {
+                    double s = v[first + i];
+                    for (size_t k = 0; k < i; ++k)
+                        s -= L[i * (i + 1) / 2 + k] * z[k];
+                    z[i] = s / L[i * (i + 1) / 2 + i];
+                }
+                for (size_t i = size; i-- > 0;) {
+                    double s = z[i];
+                    for (size_t k = i + 1; k < size; ++k)
+                        s -= L[k * (k + 1) / 2 + i] * z[k];
+                    z[i] = s / L[i * (i + 1) / 2 + i];
+                }
+            }
+        }, 64);
+    };
+
+    // Preconditioned conjugate gradients from w = 0.
+    vector<double> &w = grid.W;
+    w.assign(m, 0);
+    vector<double> r(m), z(m), p, Ap(m);
+    for (size_t i = 0; i < m; ++i)
+        r[i] = rhs[tree.index(i)];
+    const double bNorm = sqrt(dot(r, r));
+    if (bNorm > 0) {
+        precondition(r, z);
+        p = z;
+        double rz = dot(r, z);
+        for (report.Iterations = 0; report.Iterations < maxIterations;) {
+            multiply(p, Ap);
+            const double alpha = rz / dot(p, Ap);
+            forChunks(m, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    w[i] += alpha * p[i];
+                    r[i] -= alpha * Ap[i];
+                }
+            });
+            ++report.Iterations;
+            report.Residual = sqrt(dot(r, r)) / bNorm;
+            if (report.Residual <= tol)
+                break;
+            precondition(r, z);
+            const double rzNext = dot(r, z);
+            const double beta = rzNext / rz;
+            rz = rzNext;
+            forChunks(m, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i)
+                    p[i] = z[i] + beta * p[i];
+            });
+        }
+    }
+
+    Grids.push_back(move(grid));
+    Levels.push_back(report);
+    return true;
+}
+
+size_t RbfInterpolant::nonzeros() const
+{
+    size_t total = 0;
+    for (const RbfLevel &level : Levels)
+        total += level.Nonzeros;
+    return total;
+}
+
+double RbfInterpolant::trend(const double *q) const
+{
+    double t = Offset;
+    for (unsigned k = 0; k < Dimensions; ++k)
+        t += Slope[k] * (q[k] - Center[k]);
+    return t;
+}
+
+double RbfInterpolant::levelSum(const double *q, size_t count) const
+{
+    double s = 0;
+    for (size_t l = 0; l < count; ++l) {
+        const Grid &grid = Grids[l];
+        grid.Tree.radius(q, grid.Radius, [&](size_t j, double d2) {
+            s += grid.W[j] * wendland(Kernel, sqrt(d2) / grid.Radius);
+        });
+    }
+    return s;
+}
+
+double RbfInterpolant::operator()(const double *q) const
+{
+    if (!Valid)
+        return NAN;
+    return trend(q) + levelSum(q, Grids.size());
+}
+
+void RbfInterpolant::evalBatch(const double *queries, double *out, size_t n) const
+{
+    if (!Valid) {
+        fill(out, out + n, NAN);
+        return;
+    }
+    forChunks(n, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            out[i] = trend(queries + i * Dimensions) + levelSum(queries + i * Dimensions, Grids.size());
+    });
+}
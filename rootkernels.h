@@ -0,0 +1,328 @@
+#ifndef ROOTKERNELS_H
+#define ROOTKERNELS_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "jet.h"
+
+using namespace std;
+
+/**
+ * Root-finding loops with the iterate recording chosen at compile time.
+ *
+ * Each kernel takes a History policy and calls history.push(channel, v) for
+ * every bracket end ('a', 'b') and iterate ('x') it produces; the loops
+ * themselves keep their state in locals and never read the history back.
+ * RootMethods wraps them with FullHistory to build the RootResult tables;
+ * a sweep over many equations can use NoHistory, which compiles the pushes
+ * away, or LastIterates<K>, which keeps a fixed ring on the stack. Neither
+ * allocates.
+ *
+ * f is any callable double(double), such as a CompiledFunction; Newton's
+ * kernel takes a callable returning Jet<1> instead.
+ */
+
+enum RootChannel { RootA, RootB, RootX };
+
+/** What a kernel found, without the iterates. */
+struct RootSummary
+{
+    double Root = NAN;             // NaN when the method did not converge
+    int Iterations = 0;
+    int Evaluations = 0;           // calls of f (Newton: of f and f' together)
+    const char *Error = nullptr;   // set when the method could not run at all
+};
+
+/** Records nothing. */
+struct NoHistory
+{
+    void push(RootChannel, double) {}
+};
+
+/** Keeps the last K values of each channel in a ring buffer. */
+template <size_t K>
+struct LastIterates
+{
+    static_assert(K > 0, "LastIterates needs room for one value");
+
+    array<array<double, K>, 3> Values;
+    array<size_t, 3> Count = {0, 0, 0};
+
+    void push(RootChannel c, double v) { Values[c][Count[c]++ % K] = v; }
+
+    /** Values held for channel c (at most K). */
+    size_t size(RootChannel c) const { return min(Count[c], K); }
+
+    /** The i-th most recent value of channel c (0: the latest). */
+    double back(RootChannel c, size_t i = 0) const { return Values[c][(Count[c] - 1 - i) % K]; }
+};
+
+/** Every value, one array per channel. */
+struct FullHistory
+{
+    vector<double> A, B, X;
+
+    void push(RootChannel c, double v) { column(c).push_back(v); }
+
+    void reserve(size_t n)
+    {
+        A.reserve(n);
+        B.reserve(n);
+        X.reserve(n);
+    }
+
+    vector<double> &column(RootChannel c) { return c == RootA ? A : c == RootB ? B : X; }
+};
+
+// Same test as RootMethods::matchDecimals(), with 10^tol hoisted out of the loop.
+inline bool sameDecimals(double a, double b, double factor)
+{
+    return llround(a * factor) == llround(b * factor);
+}
+
+/**
+ * Bisection; assumes f(a) < 0 < f(b) as RootMethods::bisection() does.
+ * Stops when two midpoints agree to tol decimals, else reports the last one.
+ */
+template <class History, class F>
+RootSummary bisectionKernel(const F &f, pair<double, double> bracket, double tol,
+                            int maxIterations, History &history)
+{
+    RootSummary s;
+    double a = bracket.first, b = bracket.second;
+    if (isnan(a) || isnan(b)) {
+        s.Error = "Invalid bracket values.";
+        return s;
+    }
+
+    const double factor = pow(10.0, tol);
+    history.push(RootA, a);
+    history.push(RootB, b);
+
+    double c = NAN, previous = NAN;
+    for (int i = 0; i < maxIterations; ++i) {
+        c = (a + b) / 2.0;
+        history.push(RootX, c);
+        if (!isfinite(c)) {
+            s.Error = "Midpoint calculation failed.";
+            return s;
+        }
+
+        const double fc = f(c);
+        ++s.Evaluations;
+        ++s.Iterations;
+        if (isnan(fc)) {
+            s.Error = "Error evaluating f(c).";
+            return s;
+        }
+
+        const bool converged = i > 0 && sameDecimals(c, previous, factor);
+        if (fc < 0)
+            a = c; // Root is in [c, b]
+        else
+            b = c; // Root is in [a, c]
+        history.push(RootA, a);
+        history.push(RootB, b);
+
+        if (converged) {
+            c = (a + b) / 2.0;
+            history.push(RootX, c);
+            break;
+        }
+        previous = c;
+    }
+
+    // Without convergence this is the last midpoint
+    s.Root = c;
+    return s;
+}
+
+/**
+ * Secant iteration from the two bracket ends; f is evaluated once per step.
+ * Stalls (Root stays NaN) when f(x1) - f(x0) vanishes.
+ */
+template <class History, class F>
+RootSummary secantKernel(const F &f, pair<double, double> bracket, double tol,
+                         int maxIterations, History &history)
+{
+    RootSummary s;
+    double x0 = bracket.first, x1 = bracket.second;
+    history.push(RootX, x0);
+    history.push(RootX, x1);
+
+    const double factor = pow(10.0, tol);
+    double f0 = f(x0), f1 = f(x1);
+    s.Evaluations = 2;
+
+    for (int i = 2; i < maxIterations; ++i) {
+        if (fabs(f1 - f0) < 1e-10) {
+            if (i == 2)
+                s.Error = "f is equal at both starting points; secant method failed.";
+            return s;
+        }
+
+        const double x2 = x1 - f1 * (x1 - x0) / (f1 - f0);
+        history.push(RootX, x2);
+        ++s.Iterations;
+
+        if (sameDecimals(x2, x1, factor)) {
+            s.Root = x2;
+            return s;
+        }
+
+        x0 = x1;
+        f0 = f1;
+        x1 = x2;
+        f1 = f(x1);
+        ++s.Evaluations;
+    }
+    return s;
+}
+
+/**
+ * Newton's method from the bracket midpoint; `jet` returns f and f' at x
+ * as a Jet<1> (e.g. CompiledFunction::jet<1>).
+ */
+template <class History, class J>
+RootSummary newtonKernel(const J &jet, pair<double, double> bracket, double tol,
+                         int maxIterations, History &history)
+{
+    RootSummary s;
+    double x = (bracket.first + bracket.second) / 2.0;
+    if (isnan(x)) {
+        s.Error = "Cannot proceed without a valid initial guess.";
+        return s;
+    }
+    history.push(RootX, x);
+
+    const double factor = pow(10.0, tol);
+    for (int i = 0; i < maxIterations; ++i) {
+        const Jet<1> fj = jet(x);
+        ++s.Evaluations;
+        if (fabs(fj.derivative()) < 1e-10) {
+            s.Error = "Derivative too small. Newton's method failed.";
+            return s;
+        }
+
+        const double next = x - fj.value() / fj.derivative();
+        history.push(RootX, next);
+        ++s.Iterations;
+
+        if (sameDecimals(next, x, factor)) {
+            s.Root = next;
+            return s;
+        }
+        x = next;
+    }
+    return s;
+}
+
+/**
+ * ITP (interpolate, truncate, project), see RootMethods::itp(). Takes at
+ * most bisection's step count plus one; 'x' records the points evaluated
+ * and then the root.
+ */
+template <class History, class F>
+RootSummary itpKernel(const F &f, pair<double, double> bracket, double tol,
+                      int maxIterations, History &history)
+{
+    RootSummary s;
+    if (isnan(bracket.first) || isnan(bracket.second)) {
+        s.Error = "Invalid bracket values.";
+        return s;
+    }
+
+    double a = min(bracket.first, bracket.second);
+    double b = max(bracket.first, bracket.second);
+    double ya = f(a), yb = f(b);
+    s.Evaluations = 2;
+    if (isnan(ya) || isnan(yb)) {
+        s.Error = "Error evaluating f at the bracket ends.";
+        return s;
+    }
+    history.push(RootA, a);
+    history.push(RootB, b);
+    if (ya == 0 || yb == 0) {
+        s.Root = ya == 0 ? a : b;
+        history.push(RootX, s.Root);
+        return s;
+    }
+    if ((ya > 0) == (yb > 0)) {
+        s.Error = "f has the same sign at both bracket ends.";
+        return s;
+    }
+    // Work with sign * f, which is negative at a and positive at b.
+    const double sign = ya < 0 ? 1.0 : -1.0;
+    ya *= sign;
+    yb *= sign;
+
+    // Half a unit in the last requested decimal, like matchDecimals(), but
+    // no finer than the doubles around the bracket can resolve.
+    const double eps = max(0.5 * pow(10.0, -tol),
+                           4 * numeric_limits<double>::epsilon() * max(fabs(a), fabs(b)));
+    // Truncation and projection parameters (Oliveira & Takahashi, 2020).
+    const double k1 = 0.2 / (b - a), k2 = 2.0;
+    const int n0 = 1;
+    const int nHalf = max(0, int(ceil(log2((b - a) / (2 * eps)))));
+    const int nMax = nHalf + n0;
+
+    // Which end the last step moved (-1: a, 1: b), for the Illinois rule.
+    int side = 0;
+
+    for (int j = 0; j < min(nMax, maxIterations) && b - a > 2 * eps; ++j) {
+        // Interpolate: regula falsi point
+        const double xHalf = 0.5 * (a + b);
+        const double xf = (yb * a - ya * b) / (yb - ya);
+
+        // Truncate it towards the midpoint...
+        const double sigma = xHalf >= xf ? 1.0 : -1.0;
+        const double delta = k1 * pow(b - a, k2);
+        const double xt = delta <= fabs(xHalf - xf) ? xf + sigma * delta : xHalf;
+
+        // ...and project into the ball around the midpoint that keeps the
+        // total count within nMax, bisection's count plus n0.
+        const double r = eps * ldexp(1.0, nMax - j) - 0.5 * (b - a);
+        const double x = fabs(xt - xHalf) <= r ? xt : xHalf - sigma * r;
+
+        history.push(RootX, x);
+        const double y = sign * f(x);
+        ++s.Evaluations;
+        ++s.Iterations;
+        if (isnan(y)) {
+            s.Error = "Error evaluating f(x) inside the bracket.";
+            return s;
+        }
+
+        // Illinois rule: an end kept twice in a row has its value halved,
+        // so the next interpolation moves it instead of creeping one-sided.
+        if (y > 0) {
+            if (side == 1)
+                ya *= 0.5;
+            b = x;
+            yb = y;
+            side = 1;
+        } else if (y < 0) {
+            if (side == -1)
+                yb *= 0.5;
+            a = x;
+            ya = y;
+            side = -1;
+        } else {
+            a = b = x;
+        }
+        history.push(RootA, a);
+        history.push(RootB, b);
+    }
+
+    // Stopping on maxIterations early still leaves a valid bracket.
+    s.Root = 0.5 * (a + b);
+    history.push(RootX, s.Root);
+    return s;
+}
+
+#endif // ROOTKERNELS_H
@@ -1,4 +1,9 @@
 #include "rootmethods.h"
+#include "compiledfunction.h"
+#include "rootkernels.h"
+#include "threadpool.h"
+
+#include <algorithm>
 
 parser RootMethods::make_full_parser(const symbol &x)
 {
@@ -11,39 +16,118 @@ parser RootMethods::make_full_parser(const symbol &x)
 
 bool RootMethods::matchDecimals(double a, double b, double tol)
 {
-    double factor = std::pow(10.0, tol);
-    auto ai = std::llround(a * factor);
-    auto bi = std::llround(b * factor);
     // a = 2.4534, b = 2.4554
     // a = 245, b = 245
-    return ai == bi;
+    return sameDecimals(a, b, std::pow(10.0, tol));
+}
+
+// The GUI-facing result: a kernel's summary plus its recorded iterates.
+static RootResult toRootResult(const RootSummary &summary, FullHistory &history)
+{
+    if (summary.Error) {
+        cerr << summary.Error << "\n";
+        RootResult failed;
+        failed.Error = summary.Error;
+        return failed;
+    }
+
+    RootResult r;
+    if (!history.A.empty())
+        r.RootVariables['a'] = move(history.A);
+    if (!history.B.empty())
+        r.RootVariables['b'] = move(history.B);
+    if (!history.X.empty())
+        r.RootVariables['x'] = move(history.X);
+    r.Root = summary.Root;
+    r.Evaluations = summary.Evaluations;
+    return r;
+}
+
+// f and f' in one pass, for Newton: forward-mode AD on the tape, or the
+// proxy's derivative series; no symbolic derivative either way.
+static Jet<1> firstJet(const CompiledFunction &f, double x) { return f.jet<1>(x); }
+static Jet<1> firstJet(const ChebyshevProxy &f, double x) { return f.jet(x); }
+
+template <class F>
+RootResult RootMethods::solve(RootMethod method, const F &f, pair<double, double> &bracket, double tol,
+                              int maxIterations)
+{
+    FullHistory history;
+    history.reserve(maxIterations + 2);
+    RootSummary summary;
+    switch (method) {
+    case RootMethod::Newton:
+        summary = newtonKernel([&f](double x) { return firstJet(f, x); }, bracket, tol, maxIterations, history);
+        break;
+    case RootMethod::Bisection:
+        summary = bisectionKernel(f, bracket, tol, maxIterations, history);
+        break;
+    case RootMethod::Secant:
+        summary = secantKernel(f, bracket, tol, maxIterations, history);
+        break;
+    case RootMethod::Itp:
+        summary = itpKernel(f, bracket, tol, maxIterations, history);
+        break;
+    }
+    return toRootResult(summary, history);
 }
 
 pair<double, double> RootMethods::findBracket(
     const ex &f_expr, symbol x, double start, double end, double step)
 {
-    double prev_x = start;
-    double prev_f;
-
-    try {
-        prev_f = ex_to<numeric>(f_expr.subs(x == prev_x)).to_double();
-    } catch (const exception &e) {
-        cerr << "Initial function evaluation failed at x = " << prev_x << ": " << e.what() << endl;
-        prev_x += step;
-        try {
-            prev_f = ex_to<numeric>(f_expr.subs(x == prev_x)).to_double();
-        } catch (const exception &e2) {
-            cerr << "Failed again at x = " << prev_x << ": " << e2.what() << endl;
+    return findBracket(CompiledFunction(f_expr, x), start, end, step);
+}
+
+pair<double, double> RootMethods::findBracket(
+    const ExpressionHandle &f, double start, double end, double step)
+{
+    return findBracket(f->function(), start, end, step);
+}
+
+pair<double, double> RootMethods::findBracket(
+    const CompiledFunction &f, double start, double end, double step)
+{
+    // With a tape, interval subdivision finds brackets a fixed step misses
+    // (double roots, roots closer than step); the scan below is the fallback.
+    if (f.isCompiled()) {
+        vector<RootBracket> brackets = findBrackets(f, start, end);
+        if (brackets.empty()) {
+            cerr << "No root in the given range.\n";
             return {NAN, NAN};
         }
+        return preferredBracket(f, brackets);
+    }
+
+    if (!(step > 0)) {
+        cerr << "Bracket step must be positive.\n";
+        return {NAN, NAN};
     }
 
-    for (double curr_x = prev_x + step; curr_x <= end; curr_x += step) {
-        double curr_f;
-        try {
-            curr_f = ex_to<numeric>(f_expr.subs(x == curr_x)).to_double();
-        } catch (const exception &e) {
-            cerr << "Skipping x = " << curr_x << " due to error: " << e.what() << endl;
+    // Same abscissae as stepping curr_x += step, evaluated in one batch.
+    // The second point is kept even past `end` as a retry for the first.
+    vector<double> xs;
+    for (double curr_x = start; curr_x <= end || xs.size() < 2; curr_x += step)
+        xs.push_back(curr_x);
+    vector<double> fs(xs.size());
+    f.evalBatch(xs.data(), fs.data(), xs.size());
+
+    size_t first = 0;
+    if (!isfinite(fs[0])) {
+        cerr << "Initial function evaluation failed at x = " << xs[0] << endl;
+        first = 1;
+        if (!isfinite(fs[1])) {
+            cerr << "Failed again at x = " << xs[1] << endl;
+            return {NAN, NAN};
+        }
+    }
+
+    double prev_x = xs[first];
+    double prev_f = fs[first];
+    for (size_t i = first + 1; i < xs.size() && xs[i] <= end; ++i) {
+        double curr_x = xs[i];
+        double curr_f = fs[i];
+        if (!isfinite(curr_f)) {
+            cerr << "Skipping x = " << curr_x << " due to non-finite f(x)" << endl;
             continue;
         }
 
@@ -60,6 +144,137 @@ pair<double, double> RootMethods::findBracket(
     return {NAN, NAN};
 }
 
+pair<double, double> RootMethods::preferredBracket(const CompiledFunction &f, const vector<RootBracket> &brackets)
+{
+    const RootBracket *fallback = nullptr;
+    for (const RootBracket &b : brackets) {
+        const double fa = f(b.Lo), fb = f(b.Hi);
+        if (!isfinite(fa) || !isfinite(fb))
+            continue;
+        if (b.Isolated && ((fa <= 0 && fb >= 0) || (fa >= 0 && fb <= 0)))
+            return {b.Lo, b.Hi};
+        if (!fallback)
+            fallback = &b;
+    }
+    if (!fallback && !brackets.empty())
+        fallback = &brackets.front();
+    if (!fallback)
+        return {NAN, NAN};
+    return {fallback->Lo, fallback->Hi};
+}
+
+// Appends b, merging undecided pieces that touch and dropping a second
+// bracket for a root that sits exactly on a shared endpoint.
+static void addBracket(vector<RootBracket> &brackets, const RootBracket &b, bool rootOnLo)
+{
+    if (!brackets.empty() && brackets.back().Hi >= b.Lo) {
+        RootBracket &last = brackets.back();
+        if (!last.Isolated && !b.Isolated) {
+            last.Hi = b.Hi;
+            return;
+        }
+        if (rootOnLo)
+            return;
+    }
+    brackets.push_back(b);
+}
+
+vector<RootBracket> RootMethods::findBrackets(
+    const ExpressionHandle &f, double start, double end, double minWidth, int maxBoxes)
+{
+    return findBrackets(f->function(), start, end, minWidth, maxBoxes);
+}
+
+vector<RootBracket> RootMethods::findBrackets(
+    const CompiledFunction &f, double start, double end, double minWidth, int maxBoxes)
+{
+    return findBrackets(f, f.derivative(), start, end, minWidth, maxBoxes);
+}
+
+vector<RootBracket> RootMethods::findBrackets(const CompiledFunction &f, const CompiledFunction &df,
+                                              double start, double end, double minWidth, int maxBoxes)
+{
+    vector<RootBracket> brackets;
+    if (!(start < end)) {
+        cerr << "Invalid range for bracket search.\n";
+        return brackets;
+    }
+
+    if (!f.isCompiled()) {
+        // No interval extension: plain sign-change scan, nothing proven.
+        cerr << "No tape for f; scanning for sign changes instead.\n";
+        const int steps = 1000;
+        const double h = (end - start) / steps;
+        double prev = f(start);
+        for (int i = 1; i <= steps; ++i) {
+            const double x1 = start + i * h, f1 = f(x1);
+            if ((prev < 0 && f1 >= 0) || (prev > 0 && f1 <= 0))
+                addBracket(brackets, {x1 - h, x1, false}, prev == 0);
+            prev = f1;
+        }
+        return brackets;
+    }
+
+    vector<Interval> pending = {Interval(start, end)};
+    int boxes = 0;
+
+    // Depth-first, left half on top, so brackets come out in order.
+    while (!pending.empty()) {
+        const Interval I = pending.back();
+        pending.pop_back();
+        if (++boxes > maxBoxes) {
+            cerr << "Bracket search stopped after " << maxBoxes << " subintervals.\n";
+            break;
+        }
+
+        // Natural extension intersected with the mean-value form
+        // f(m) + f'(I) (I - m), which is much tighter near multiple roots.
+        const Interval D = df.evalInterval(I);
+        const Interval m(I.mid());
+        Interval F = f.evalInterval(I);
+        // Monotonicity only proves one root where f is continuous; an
+        // unbounded natural extension may hide a pole.
+        const bool bounded = isfinite(F.Lo) && isfinite(F.Hi);
+        const Interval mv = f.evalInterval(m) + D * (I - m);
+        if (!mv.isEmpty()) {
+            F.Lo = max(F.Lo, mv.Lo);
+            F.Hi = min(F.Hi, mv.Hi);
+        }
+        if (F.isEmpty() || !F.contains(0))
+            continue; // provably no root in I
+
+        // Endpoint values as enclosures, so rounding noise near a flat
+        // stretch is never mistaken for a sign change.
+        const Interval FLo = f.evalInterval(Interval(I.Lo)), FHi = f.evalInterval(Interval(I.Hi));
+        const bool monotone = !D.isEmpty() && !D.contains(0);
+        if (monotone && bounded) {
+            // Strictly monotone: one root iff the sign changes.
+            if ((FLo.Hi <= 0 && FHi.Lo >= 0) || (FLo.Lo >= 0 && FHi.Hi <= 0)) {
+                addBracket(brackets, {I.Lo, I.Hi, true}, FLo.contains(0));
+                continue;
+            }
+            if (!FLo.contains(0) && !FHi.contains(0))
+                continue;
+            // An endpoint value is within rounding of 0: keep splitting.
+        }
+
+        const double mid = m.Lo;
+        if (I.width() <= minWidth || mid <= I.Lo || mid >= I.Hi) {
+            if (!bounded)
+                continue; // a pole (or overflow), not a root
+            // Monotone with a root within rounding of one end (a simple
+            // root on a split point): still exactly one root.
+            const bool isolated = monotone && !(FLo.contains(0) && FHi.contains(0));
+            addBracket(brackets, {I.Lo, I.Hi, isolated}, FLo.contains(0));
+            continue;
+        }
+        pending.push_back(Interval(mid, I.Hi));
+        pending.push_back(Interval(I.Lo, mid));
+    }
+
+    return brackets;
+}
+
 double RootMethods::findInitialGuess(const pair<double, double> &bracket)
 {
     if (isnan(bracket.first) || isnan(bracket.second)) {
@@ -72,128 +287,491 @@ double RootMethods::findInitialGuess(const pair<double, double> &bracket)
 RootResult RootMethods::newton(
     const ex &f_expr, symbol x, pair<double, double> &bracket, double tol, int maxIterations)
 {
-    RootResult History;
-    History.RootVariables['x'].push_back(findInitialGuess(bracket));
-    if (isnan(History.RootVariables['x'][0])) {
-        cerr << "Cannot proceed without a valid initial guess.\n";
+    return newton(CompiledFunction(f_expr, x), bracket, tol, maxIterations);
+}
+
+RootResult RootMethods::newton(
+    const ExpressionHandle &f, pair<double, double> &bracket, double tol, int maxIterations)
+{
+    return solve(RootMethod::Newton, f->function(), bracket, tol, maxIterations);
+}
+
+RootResult RootMethods::newton(
+    const CompiledFunction &f, pair<double, double> &bracket, double tol, int maxIterations)
+{
+    return solve(RootMethod::Newton, f, bracket, tol, maxIterations);
+}
+
+RootResult RootMethods::bisection(
+    const ex &f_expr, symbol x, pair<double, double> &bracket, double tol, int maxIterations)
+{
+    return bisection(CompiledFunction(f_expr, x), bracket, tol, maxIterations);
+}
+
+RootResult RootMethods::bisection(
+    const ExpressionHandle &f, pair<double, double> &bracket, double tol, int maxIterations)
+{
+    return solve(RootMethod::Bisection, f->function(), bracket, tol, maxIterations);
+}
+
+RootResult RootMethods::bisection(
+    const CompiledFunction &f, pair<double, double> &bracket, double tol, int maxIterations)
+{
+    return solve(RootMethod::Bisection, f, bracket, tol, maxIterations);
+}
+
+RootResult RootMethods::secant(
+    const ex &f_expr, symbol x, pair<double, double> &bracket, double tol, int maxIterations)
+{
+    return secant(CompiledFunction(f_expr, x), bracket, tol, maxIterations);
+}
+
+RootResult RootMethods::secant(
+    const ExpressionHandle &f, pair<double, double> &bracket, double tol, int maxIterations)
+{
+    return solve(RootMethod::Secant, f->function(), bracket, tol, maxIterations);
+}
+
+RootResult RootMethods::secant(
+    const CompiledFunction &f, pair<double, double> &bracket, double tol, int maxIterations)
+{
+    return solve(RootMethod::Secant, f, bracket, tol, maxIterations);
+}
+
+RootResult RootMethods::itp(
+    const ex &f_expr, symbol x, pair<double, double> &bracket, double tol, int maxIterations)
+{
+    return itp(CompiledFunction(f_expr, x), bracket, tol, maxIterations);
+}
+
+RootResult RootMethods::itp(
+    const ExpressionHandle &f, pair<double, double> &bracket, double tol, int maxIterations)
+{
+    return solve(RootMethod::Itp, f->function(), bracket, tol, maxIterations);
+}
+
+RootResult RootMethods::itp(
+    const CompiledFunction &f, pair<double, double> &bracket, double tol, int maxIterations)
+{
+    return solve(RootMethod::Itp, f, bracket, tol, maxIterations);
+}
+
+RootResult RootMethods::newton(
+    const ChebyshevProxy &f, pair<double, double> &bracket, double tol, int maxIterations)
+{
+    return solve(RootMethod::Newton, f, bracket, tol, maxIterations);
+}
+
+RootResult RootMethods::bisection(
+    const ChebyshevProxy &f, pair<double, double> &bracket, double tol, int maxIterations)
+{
+    return solve(RootMethod::Bisection, f, bracket, tol, maxIterations);
+}
+
+RootResult RootMethods::secant(
+    const ChebyshevProxy &f, pair<double, double> &bracket, double tol, int maxIterations)
+{
+    return solve(RootMethod::Secant, f, bracket, tol, maxIterations);
+}
+
+RootResult RootMethods::itp(
+    const ChebyshevProxy &f, pair<double, double> &bracket, double tol, int maxIterations)
+{
+    return solve(RootMethod::Itp, f, bracket, tol, maxIterations);
+}
+
+// Whether f nearly vanishes at x: f is exactly 0, or one Newton step
+// f / f' moves x by at most 10 eps (relative to |x| beyond 1). Rejects a
+// solver that stopped on a bracket end or anywhere else f is not small.
+static bool nearRoot(const CompiledFunction &f, double x, double eps)
+{
+    const Jet<1> j = f.jet<1>(x);
+    if (j.C[0] == 0)
+        return true;
+    return isfinite(j.C[0]) && fabs(j.C[0]) <= 10 * eps * max(1.0, fabs(x)) * fabs(j.C[1]);
+}
+
+vector<RootResult> RootMethods::allRoots(const ExpressionHandle &f, double start, double end,
+                                         RootMethod method, double tol, int maxIterations,
+                                         int chunksPerThread)
+{
+    return allRoots(f->function(), start, end, method, tol, maxIterations, chunksPerThread);
+}
+
+vector<RootResult> RootMethods::allRoots(const CompiledFunction &f, double start, double end,
+                                         RootMethod method, double tol, int maxIterations,
+                                         int chunksPerThread)
+{
+    if (!(start < end)) {
+        cerr << "Invalid range for root scan.\n";
         return {};
     }
 
-    ex df_expr = diff(f_expr, x);
+    ThreadPool &pool = ThreadPool::instance();
+    const size_t chunks = size_t(pool.size()) * max(chunksPerThread, 1);
+    const double width = (end - start) / chunks;
+    const CompiledFunction df = f.derivative();
+    const double eps = std::pow(10.0, -tol);
+    vector<vector<RootResult>> found(chunks);
 
-    for (int i = 0; i < maxIterations; i++) {
-        double fx = ex_to<numeric>(f_expr.subs(x == History.RootVariables['x'][i])).to_double();
-        double dfx = ex_to<numeric>(df_expr.subs(x == History.RootVariables['x'][i])).to_double();
+    auto scan = [&](size_t c) {
+        const double lo = start + c * width;
+        const double hi = c + 1 == chunks ? end : start + (c + 1) * width;
+        for (const RootBracket &b : findBrackets(f, df, lo, hi)) {
+            pair<double, double> bracket(b.Lo, b.Hi);
+            RootResult r;
+            // Bracketing methods need a sign change; a non-isolated
+            // bracket (double root) goes to Newton from its midpoint.
+            if (method == RootMethod::Newton || !b.Isolated)
+                r = newton(f, bracket, tol, maxIterations);
+            else if (method == RootMethod::Secant)
+                r = secant(f, bracket, tol, maxIterations);
+            else if (method == RootMethod::Itp)
+                r = itp(f, bracket, tol, maxIterations);
+            else {
+                // The kernel keeps f < 0 at the first end; orient the
+                // bracket, or a decreasing f would drive it to an endpoint.
+                if (f(bracket.first) > 0)
+                    swap(bracket.first, bracket.second);
+                r = bisection(f, bracket, tol, maxIterations);
+            }
 
-        if (fabs(dfx) < 1e-10) {
-            cerr << "Derivative too small. Newton's method failed.\n";
-            return {};
+            if (isnan(r.Root) && !b.Isolated && b.Hi - b.Lo <= 1e-6) {
+                // f' vanishes at an even-order root; the bracket is already tight.
+                r.RootVariables['x'].push_back(0.5 * (b.Lo + b.Hi));
+                r.Root = r.RootVariables['x'].back();
+            }
+            if (isfinite(r.Root) && nearRoot(f, r.Root, eps))
+                found[c].push_back(move(r));
         }
+    };
 
-        History.RootVariables['x'].push_back(History.RootVariables['x'][i] - fx / dfx);
-        double root;
-        if (matchDecimals(History.RootVariables['x'][i + 1], History.RootVariables['x'][i], tol)) {
-            History.Root = History.RootVariables['x'][i + 1];
-            break;
+    if (f.isCompiled() && df.isCompiled()) {
+        pool.parallelFor(chunks, scan);
+    } else {
+        for (size_t c = 0; c < chunks; ++c)
+            scan(c);
+    }
+
+    vector<RootResult> roots;
+    for (vector<RootResult> &chunk : found)
+        for (RootResult &r : chunk)
+            roots.push_back(move(r));
+    sort(roots.begin(), roots.end(),
+         [](const RootResult &a, const RootResult &b) { return a.Root < b.Root; });
+
+    // Merge duplicates: the same root reached from both sides of a chunk
+    // boundary, or from neighbouring brackets of one cluster.
+    vector<RootResult> merged;
+    for (RootResult &r : roots) {
+        if (!merged.empty() && fabs(r.Root - merged.back().Root) <= eps * max(1.0, fabs(r.Root)))
+            continue;
+        merged.push_back(move(r));
+    }
+    return merged;
+}
+
+// p(z) / p'(z) for p(z) = sum a[k] z^k, and whether p(z) is within rounding
+// of zero (|p(z)| below eps times sum |a[k]| |z|^k). Outside the unit disc
+// the reversed polynomial is used, so z^n cannot overflow.
+static complex<double> newtonRatio(const vector<double> &a, complex<double> z, bool &atRoot)
+{
+    const int n = int(a.size()) - 1;
+    const double eps = numeric_limits<double>::epsilon();
+    complex<double> p, dp;
+    double bound = 0;
+
+    if (abs(z) <= 1) {
+        for (int k = n; k >= 0; --k) {
+            dp = dp * z + p;
+            p = p * z + a[k];
+            bound = bound * abs(z) + fabs(a[k]);
         }
+        atRoot = abs(p) <= eps * bound;
+        return p / dp;
     }
 
-    return History;
+    // p(z) = z^n q(y), p'(z) = z^(n-1) (n q(y) - y q'(y)) with y = 1/z
+    const complex<double> y = 1.0 / z;
+    complex<double> q, dq;
+    for (int k = 0; k <= n; ++k) {
+        dq = dq * y + q;
+        q = q * y + a[k];
+        bound = bound * abs(y) + fabs(a[k]);
+    }
+    atRoot = abs(q) <= eps * bound;
+    return z * q / (double(n) * q - y * dq);
 }
 
-RootResult RootMethods::bisection(
-    const ex &f_expr, symbol x, pair<double, double> &bracket, double tol, int maxIterations)
+PolynomialRoots RootMethods::polynomialRoots(const ExpressionHandle &f, double tol, int maxIterations)
+{
+    return polynomialRoots(f->expr(), f->variable(), tol, maxIterations);
+}
+
+PolynomialRoots RootMethods::polynomialRoots(const ex &f_expr, const symbol &x, double tol,
+                                             int maxIterations)
 {
-    RootResult History;
+    PolynomialRoots result;
+    if (!is_polynomial(f_expr, x))
+        return result;
 
-    // Safety: check initial values
-    if (isnan(bracket.first) || isnan(bracket.second)) {
-        cerr << "Invalid bracket values.\n";
-        return {};
+    // Coefficients, lowest power first
+    const ex expanded = expand(f_expr);
+    const int degree = expanded.degree(x);
+    vector<double> a(max(degree, 0) + 1);
+    for (int k = 0; k <= degree; ++k) {
+        const ex c = expanded.coeff(x, k).evalf();
+        if (!is_a<numeric>(c) || !ex_to<numeric>(c).is_real())
+            return result;
+        a[k] = ex_to<numeric>(c).to_double();
     }
+    result.Degree = degree;
 
-    History.RootVariables['a'].push_back(bracket.first);
-    History.RootVariables['b'].push_back(bracket.second);
+    // x^m factor: m roots at zero, then solve the rest
+    size_t zeros = 0;
+    while (zeros + 1 < a.size() && a[zeros] == 0)
+        ++zeros;
+    a.erase(a.begin(), a.begin() + zeros);
+    const int n = int(a.size()) - 1;
 
-    for (int i = 0; i < maxIterations; ++i) {
-        History.RootVariables['x'].push_back(
-            (History.RootVariables['a'].back() + History.RootVariables['b'].back()) / 2.0);
-        if (isnan(History.RootVariables['x'].back()) || isinf(History.RootVariables['x'].back())) {
-            cerr << "Midpoint calculation failed.\n";
-            return {};
-        }
+    vector<complex<double>> z;
+    if (n >= 1) {
+        // Start on a circle around the centroid of the roots, of radius
+        // the Fujiwara bound; the angular offset avoids real symmetry.
+        const double center = -a[n - 1] / (n * a[n]);
+        double radius = 0;
+        for (int k = 0; k < n; ++k)
+            radius = max(radius, std::pow(fabs(a[k] / a[n]), 1.0 / (n - k)));
+        radius = max(2 * radius, 1e-3);
+        const double Pi = 3.14159265358979323846;
+        for (int k = 0; k < n; ++k)
+            z.push_back(center + std::polar(radius, 2 * Pi * k / n + 0.4));
 
-        double fc;
-        try {
-            fc = ex_to<numeric>(f_expr.subs(x == History.RootVariables['x'].back())).to_double();
-        } catch (const std::exception &e) {
-            cerr << "Error evaluating f(c): " << e.what() << endl;
-            return {};
+        // Aberth–Ehrlich, updating in place (Gauss–Seidel style)
+        vector<bool> done(n, false);
+        int remaining = n;
+        for (int it = 0; it < maxIterations && remaining > 0; ++it) {
+            ++result.Iterations;
+            for (int k = 0; k < n; ++k) {
+                if (done[k])
+                    continue;
+                bool atRoot;
+                const complex<double> ratio = newtonRatio(a, z[k], atRoot);
+                complex<double> sum;
+                for (int j = 0; j < n; ++j) {
+                    if (j != k)
+                        sum += 1.0 / (z[k] - z[j]);
+                }
+                const complex<double> w = ratio / (1.0 - ratio * sum);
+                z[k] -= w;
+                // Done once the step is at rounding level or p(z) is; the
+                // second stops multiple roots, where Aberth is only linear.
+                if (atRoot || abs(w) <= 2 * numeric_limits<double>::epsilon() * abs(z[k])) {
+                    done[k] = true;
+                    --remaining;
+                }
+            }
         }
+        result.Converged = remaining == 0;
+    } else {
+        result.Converged = true;
+    }
+    z.insert(z.end(), zeros, 0.0);
+
+    // Coefficients are real: a root within 10^-tol of the axis is real.
+    const double eps = std::pow(10.0, -tol);
+    for (complex<double> &r : z) {
+        if (fabs(r.imag()) <= eps * max(1.0, abs(r)))
+            r = r.real();
+    }
+    sort(z.begin(), z.end(), [](const complex<double> &u, const complex<double> &v) {
+        const bool ur = u.imag() == 0, vr = v.imag() == 0;
+        if (ur != vr)
+            return ur;
+        if (u.real() != v.real())
+            return u.real() < v.real();
+        return u.imag() < v.imag();
+    });
+    result.RealCount = count_if(z.begin(), z.end(),
+                                [](const complex<double> &r) { return r.imag() == 0; });
+    result.Roots = move(z);
+    return result;
+}
+
+// One batch of Newton lanes. x, p and lane hold the active lanes packed at
+// the front; after each step the survivors are packed again, so the batch
+// evaluations only ever run over lanes still iterating.
+static void newtonLanes(const CompiledFunction &f, const CompiledFunction &df,
+                        const double *params, size_t n, double x0, double tol,
+                        int maxIterations, double *roots, int *iterations)
+{
+    vector<double> x(n, x0), p(params, params + n), fx(n), dfx(n);
+    vector<size_t> lane(n);
+    for (size_t i = 0; i < n; ++i)
+        lane[i] = i;
+
+    const double factor = std::pow(10.0, tol);
+    size_t active = n;
+    for (int it = 0; it < maxIterations && active > 0; ++it) {
+        const double *columns[2] = {x.data(), p.data()};
+        f.evalBatch(columns, fx.data(), active);
+        df.evalBatch(columns, dfx.data(), active);
+
+        size_t kept = 0;
+        for (size_t k = 0; k < active; ++k) {
+            const size_t i = lane[k];
+            ++iterations[i];
+            if (!(fabs(dfx[k]) >= 1e-10))
+                continue; // derivative too small (or NaN): lane fails
 
-        // Check for convergence
-        if (matchDecimals(History.RootVariables['x'][i], History.RootVariables['x'][i - 1], tol)) {
-            if (fc < 0) {
-                // Root is in [c, b]
-                History.RootVariables['a'].push_back(History.RootVariables['x'].back());
-                History.RootVariables['b'].push_back(History.RootVariables['b'].back());
-            } else {
-                // Root is in [a, c]
-                History.RootVariables['a'].push_back(History.RootVariables['a'].back());
-                History.RootVariables['b'].push_back(History.RootVariables['x'].back());
+            const double next = x[k] - fx[k] / dfx[k];
+            if (!isfinite(next))
+                continue;
+            if (sameDecimals(next, x[k], factor)) {
+                roots[i] = next;
+                continue;
             }
-            History.RootVariables['x'].push_back(
-                (History.RootVariables['a'].back() + History.RootVariables['b'].back()) / 2.0);
-            History.Root = History.RootVariables['x'].back();
-            return History;
+            x[kept] = next;
+            p[kept] = p[k];
+            lane[kept] = i;
+            ++kept;
         }
+        active = kept;
+    }
+}
 
-        // Update a or b depending on sign
-        if (fc < 0) {
-            // Root is in [c, b]
-            History.RootVariables['a'].push_back(History.RootVariables['x'].back());
-            History.RootVariables['b'].push_back(History.RootVariables['b'].back());
-        } else {
-            // Root is in [a, c]
-            History.RootVariables['a'].push_back(History.RootVariables['a'].back());
-            History.RootVariables['b'].push_back(History.RootVariables['x'].back());
+// One batch of bisection lanes, packed like newtonLanes(). Each lane keeps
+// the end where f is negative in `neg`, so families whose sign at the
+// bracket ends flips with p are handled.
+static void bisectionLanes(const CompiledFunction &f, const double *params, size_t n,
+                           double lo, double hi, double tol, int maxIterations,
+                           double *roots, int *iterations)
+{
+    vector<double> x(n, lo), p(params, params + n), fLo(n), fHi(n);
+    const double *columns[2] = {x.data(), p.data()};
+    f.evalBatch(columns, fLo.data(), n);
+    fill(x.begin(), x.end(), hi);
+    f.evalBatch(columns, fHi.data(), n);
+
+    vector<double> neg(n), pos(n), previous(n), fc(n);
+    vector<size_t> lane(n);
+    size_t active = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (fLo[i] == 0 || fHi[i] == 0) {
+            roots[i] = fLo[i] == 0 ? lo : hi;
+            continue;
         }
+        if (!(fLo[i] * fHi[i] < 0))
+            continue; // no sign change (or NaN) for this p
+        neg[active] = fLo[i] < 0 ? lo : hi;
+        pos[active] = fLo[i] < 0 ? hi : lo;
+        p[active] = p[i];
+        lane[active] = i;
+        ++active;
     }
 
-    // If loop ends without convergence, return last midpoint
-    History.Root = History.RootVariables['x'].back();
-    return History;
+    const double factor = std::pow(10.0, tol);
+    for (int it = 0; it < maxIterations && active > 0; ++it) {
+        for (size_t k = 0; k < active; ++k)
+            x[k] = 0.5 * (neg[k] + pos[k]);
+        f.evalBatch(columns, fc.data(), active);
+
+        size_t kept = 0;
+        for (size_t k = 0; k < active; ++k) {
+            const size_t i = lane[k];
+            ++iterations[i];
+            if (isnan(fc[k]))
+                continue;
+            const double c = x[k];
+            if (fc[k] < 0)
+                neg[k] = c;
+            else
+                pos[k] = c;
+            if (fc[k] == 0 || (it > 0 && sameDecimals(c, previous[k], factor))) {
+                roots[i] = fc[k] == 0 ? c : 0.5 * (neg[k] + pos[k]);
+                continue;
+            }
+            neg[kept] = neg[k];
+            pos[kept] = pos[k];
+            previous[kept] = c;
+            p[kept] = p[k];
+            lane[kept] = i;
+            ++kept;
+        }
+        active = kept;
+    }
 }
 
-RootResult RootMethods::secant(
-    const ex &f_expr, symbol x, pair<double, double> &bracket, double tol, int maxIterations)
+ParametricRoots RootMethods::solveParametric(const ExpressionHandle &f, const vector<double> &params,
+                                             pair<double, double> bracket, RootMethod method,
+                                             double tol, int maxIterations, size_t batchSize)
 {
-    RootResult History;
-    History.RootVariables['x'].push_back(bracket.first);
-    History.RootVariables['x'].push_back(bracket.second);
+    return solveParametric(f->function(), params, bracket, method, tol, maxIterations, batchSize);
+}
 
-    for (int i = 2; i < maxIterations; i++) {
-        double f_x0 = ex_to<numeric>(f_expr.subs(x == History.RootVariables['x'][i - 2])).to_double();
-        double f_x1 = ex_to<numeric>(f_expr.subs(x == History.RootVariables['x'][i - 1])).to_double();
-        cout << "F(Xm) = " << f_x1 << endl << "F(Xm-1) = " << f_x0 << endl;
+ParametricRoots RootMethods::solveParametric(const CompiledFunction &f, const vector<double> &params,
+                                             pair<double, double> bracket, RootMethod method,
+                                             double tol, int maxIterations, size_t batchSize)
+{
+    if (f.variables() != 2) {
+        cerr << "Parametric solve needs f(x, p): two variables.\n";
+        return {};
+    }
+    if (isnan(bracket.first) || isnan(bracket.second)) {
+        cerr << "Invalid bracket values.\n";
+        return {};
+    }
 
-        if (fabs(f_x1 - f_x0) < 1e-10) {
-            if (i > 2)
-                return History;
-            else
-                return {};
-        }
+    const size_t n = params.size();
+    ParametricRoots result;
+    result.Roots.assign(n, NAN);
+    result.Iterations.assign(n, 0);
+
+    // Compiled here, on the calling thread: GiNaC is not thread-safe.
+    CompiledFunction df;
+    if (method == RootMethod::Newton)
+        df = f.derivative(0);
 
-        History.RootVariables['x'].push_back(
-            History.RootVariables['x'][i - 1]
-            - (f_x1 * (History.RootVariables['x'][i - 1] - History.RootVariables['x'][i - 2])
-               / (f_x1 - f_x0)));
+    batchSize = max<size_t>(batchSize, 1);
+    const size_t batches = (n + batchSize - 1) / batchSize;
+    auto solveBatch = [&](size_t b) {
+        const size_t offset = b * batchSize;
+        const size_t m = min(batchSize, n - offset);
+        double *roots = result.Roots.data() + offset;
+        int *iterations = result.Iterations.data() + offset;
 
-        if (matchDecimals(History.RootVariables['x'][i], History.RootVariables['x'][i - 1], tol)) {
-            History.Root = History.RootVariables['x'][i];
+        switch (method) {
+        case RootMethod::Newton:
+            newtonLanes(f, df, params.data() + offset, m, findInitialGuess(bracket), tol,
+                        maxIterations, roots, iterations);
+            break;
+        case RootMethod::Bisection:
+            bisectionLanes(f, params.data() + offset, m, bracket.first, bracket.second, tol,
+                           maxIterations, roots, iterations);
             break;
+        default:
+            // No lane-parallel form: the scalar kernels, without history.
+            for (size_t k = 0; k < m; ++k) {
+                const double p = params[offset + k];
+                auto fp = [&f, p](double x) { return f(x, p); };
+                NoHistory none;
+                const RootSummary s = method == RootMethod::Secant
+                                          ? secantKernel(fp, bracket, tol, maxIterations, none)
+                                          : itpKernel(fp, bracket, tol, maxIterations, none);
+                roots[k] = s.Root;
+                iterations[k] = s.Iterations;
+            }
         }
+    };
+
+    if (f.isCompiled() && (method != RootMethod::Newton || df.isCompiled())) {
+        ThreadPool::instance().parallelFor(batches, solveBatch);
+    } else {
+        for (size_t b = 0; b < batches; ++b)
+            solveBatch(b);
     }
 
-    return History;
+    for (double r : result.Roots)
+        result.Converged += isfinite(r);
+    return result;
 }
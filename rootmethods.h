@@ -2,6 +2,7 @@
 #define ROOTMETHODS_H
 
 #include <cmath>
+#include <complex>
 #include <ginac/ginac.h>
 #include <iomanip>
 #include <iostream>
@@ -9,6 +10,11 @@
 #include <utility>
 #include <vector>
 
+#include "chebyshev.h"
+#include "compiledfunction.h"
+#include "expressionregistry.h"
+#include "rootkernels.h"
+
 // #include "method.h"
 
 using namespace std;
@@ -17,7 +23,36 @@ using namespace GiNaC;
 struct RootResult
 {
     map<char, vector<double>> RootVariables;
-    double Root;
+    double Root = NAN; // stays NaN when the method does not converge
+    int Evaluations = 0; // calls of f (for Newton, f and f' in one pass)
+    string Error;        // why the method could not run; RootVariables is then empty
+};
+
+enum class RootMethod { Bisection, Secant, Newton, Itp };
+
+struct RootBracket
+{
+    double Lo, Hi;
+    bool Isolated; // f monotone with a sign change: exactly one simple root
+                   // (false: a cluster or even-order root, width <= minWidth)
+};
+
+/** Every root of a polynomial, from RootMethods::polynomialRoots(). */
+struct PolynomialRoots
+{
+    vector<complex<double>> Roots; // real ones first (ascending), then complex by real part
+    size_t RealCount = 0;
+    int Degree = -1;                // -1: not a polynomial with numeric coefficients
+    int Iterations = 0;
+    bool Converged = false;
+};
+
+/** Roots of a parametric family f(x; p), one lane per parameter value. */
+struct ParametricRoots
+{
+    vector<double> Roots;   // NaN where the lane failed or did not converge
+    vector<int> Iterations;
+    size_t Converged = 0;
 };
 
 class RootMethods
@@ -30,27 +65,197 @@ public:
     bool matchDecimals(double a, double b, double tol = 1e-6);
 
     pair<double, double> findBracket(const ex &f_expr, symbol x, double start, double end, double step = 1);
+    pair<double, double> findBracket(const ExpressionHandle &f, double start, double end, double step = 1);
+    pair<double, double> findBracket(const CompiledFunction &f, double start, double end, double step = 1);
+
+    /**
+     * Every root bracket of f on [start, end], by interval subdivision.
+     *
+     * Subintervals whose interval extension of f excludes 0 provably hold no
+     * root and are dropped; those where f' excludes 0 hold at most one and
+     * are kept if f changes sign, provided f is bounded there (so a pole
+     * with a sign change is never taken for a root). Anything still
+     * undecided at minWidth (double roots, tight clusters) is returned with
+     * Isolated = false; boxes where f is unbounded are dropped there.
+     * Work grows with the number of roots, not with (end - start).
+     *
+     * @param minWidth  Narrowest subinterval examined
+     * @param maxBoxes  Safety cap on subintervals visited
+     * @return          Brackets in increasing order
+     */
+    vector<RootBracket> findBrackets(const CompiledFunction &f, double start, double end,
+                                     double minWidth = 1e-9, int maxBoxes = 200000);
+    vector<RootBracket> findBrackets(const ExpressionHandle &f, double start, double end,
+                                     double minWidth = 1e-9, int maxBoxes = 200000);
+    /** Same, with f' already compiled (no GiNaC work, so safe off the GUI thread). */
+    vector<RootBracket> findBrackets(const CompiledFunction &f, const CompiledFunction &df,
+                                     double start, double end,
+                                     double minWidth = 1e-9, int maxBoxes = 200000);
+
+    /**
+     * The bracket to solve in: the first isolated one whose ends have finite
+     * values of opposite sign, else the first one with finite end values,
+     * else the first one. {NaN, NaN} when there are none.
+     */
+    static pair<double, double> preferredBracket(const CompiledFunction &f, const vector<RootBracket> &brackets);
 
     double findInitialGuess(const pair<double, double> &bracket); // mid point
 
     // —————— ROOT-FINDERS ——————
+    // Each records its full history for the GUI; rootkernels.h has the same
+    // loops with no or bounded history for bulk solving.
     RootResult newton(const ex &f_expr,
                             symbol x,
                             pair<double, double> &bracket,
                             double tol,
                             int maxIterations = 100);
+    RootResult newton(const ExpressionHandle &f,
+                      pair<double, double> &bracket,
+                      double tol,
+                      int maxIterations = 100);
+    RootResult newton(const CompiledFunction &f,
+                      pair<double, double> &bracket,
+                      double tol,
+                      int maxIterations = 100);
 
     RootResult bisection(const ex &f_expr,
                                symbol x,
                                pair<double, double> &bracket,
                                double tol,
                                int maxIterations = 100);
+    RootResult bisection(const ExpressionHandle &f,
+                         pair<double, double> &bracket,
+                         double tol,
+                         int maxIterations = 100);
+    RootResult bisection(const CompiledFunction &f,
+                         pair<double, double> &bracket,
+                         double tol,
+                         int maxIterations = 100);
 
     RootResult secant(const ex &f_expr,
                             symbol x,
                             pair<double, double> &bracket,
                             double tol,
                             int maxIterations = 100);
+    RootResult secant(const ExpressionHandle &f,
+                      pair<double, double> &bracket,
+                      double tol,
+                      int maxIterations = 100);
+    RootResult secant(const CompiledFunction &f,
+                      pair<double, double> &bracket,
+                      double tol,
+                      int maxIterations = 100);
+
+    /**
+     * ITP (interpolate, truncate, project): a regula falsi step pulled
+     * towards the midpoint and kept close enough to it that the root is
+     * never found later than bisection plus one step would find it, while
+     * converging superlinearly near a simple root.
+     *
+     * @param bracket  [a, b] with f(a) and f(b) of opposite sign
+     * @param tol      Decimal places required of the root
+     * @return         History: 'x' the points evaluated (then the root),
+     *                 'a', 'b' the bracket before and after each step
+     */
+    RootResult itp(const ex &f_expr,
+                   symbol x,
+                   pair<double, double> &bracket,
+                   double tol,
+                   int maxIterations = 100);
+    RootResult itp(const ExpressionHandle &f,
+                   pair<double, double> &bracket,
+                   double tol,
+                   int maxIterations = 100);
+    RootResult itp(const CompiledFunction &f,
+                   pair<double, double> &bracket,
+                   double tol,
+                   int maxIterations = 100);
+
+    // —————— ON A CHEBYSHEV PROXY ——————
+    /**
+     * The same four methods run on a ChebyshevProxy of f instead of f, for
+     * when f is expensive: every iterate costs one Clenshaw pass (Newton's
+     * f' comes from the proxy's derivative series), and f was only sampled
+     * to build the proxy. The root is the proxy's; it is off from f's by
+     * about proxy.maxError() / |f'(root)|.
+     *
+     * @return  Evaluations counts proxy evaluations
+     */
+    RootResult newton(const ChebyshevProxy &f, pair<double, double> &bracket, double tol,
+                      int maxIterations = 100);
+    RootResult bisection(const ChebyshevProxy &f, pair<double, double> &bracket, double tol,
+                         int maxIterations = 100);
+    RootResult secant(const ChebyshevProxy &f, pair<double, double> &bracket, double tol,
+                      int maxIterations = 100);
+    RootResult itp(const ChebyshevProxy &f, pair<double, double> &bracket, double tol,
+                   int maxIterations = 100);
+
+    // —————— POLYNOMIALS ——————
+    /**
+     * All real and complex roots of a polynomial in x, with no bracketing.
+     *
+     * Coefficients are taken from the expanded ex (they must evaluate to
+     * real numbers) and every root is refined at once by Aberth–Ehrlich
+     * iteration: O(degree^2) per sweep, a few dozen sweeps in practice.
+     * A root whose imaginary part is below 10^-tol is reported as real.
+     *
+     * @return  Degree -1 if f is not such a polynomial
+     */
+    PolynomialRoots polynomialRoots(const ex &f_expr, const symbol &x, double tol,
+                                    int maxIterations = 500);
+    PolynomialRoots polynomialRoots(const ExpressionHandle &f, double tol,
+                                    int maxIterations = 500);
+
+    // —————— PARAMETRIC FAMILIES ——————
+    /**
+     * Solve f(x; p) = 0 for every p in params.
+     *
+     * f has two variables, x then the parameter (e.g. a handle from
+     * ExpressionRegistry::get(text, {"x", "a"})); f' is compiled once for
+     * all lanes. Newton and bisection run the lanes of a batch together:
+     * each step is one evalBatch() over the lanes still active, and lanes
+     * that converge or fail are compacted away. Secant and ITP run the
+     * scalar kernels lane by lane. Batches are spread over the ThreadPool.
+     *
+     * @param bracket    Search interval shared by all lanes (Newton starts
+     *                   from its midpoint; bisection orients each lane by
+     *                   the sign of f at the ends)
+     * @param batchSize  Lanes per batch
+     */
+    ParametricRoots solveParametric(const ExpressionHandle &f, const vector<double> &params,
+                                    pair<double, double> bracket, RootMethod method,
+                                    double tol, int maxIterations = 100,
+                                    size_t batchSize = 4096);
+    ParametricRoots solveParametric(const CompiledFunction &f, const vector<double> &params,
+                                    pair<double, double> bracket, RootMethod method,
+                                    double tol, int maxIterations = 100,
+                                    size_t batchSize = 4096);
+
+    // —————— ALL ROOTS ——————
+    /**
+     * Every root of f on [start, end].
+     *
+     * The range is cut into chunks that the shared work-stealing ThreadPool
+     * brackets independently (findBrackets) and refines with `method`.
+     * Roots found twice across a chunk boundary, or closer than 10^-tol,
+     * are merged. GiNaC is not thread-safe, so f' is compiled up front and
+     * functions without a tape are scanned on the calling thread.
+     *
+     * @param chunksPerThread  Chunks per pool worker; more evens out load
+     * @return                 Converged roots in increasing order
+     */
+    vector<RootResult> allRoots(const CompiledFunction &f, double start, double end,
+                                RootMethod method, double tol, int maxIterations = 100,
+                                int chunksPerThread = 8);
+    vector<RootResult> allRoots(const ExpressionHandle &f, double start, double end,
+                                RootMethod method, double tol, int maxIterations = 100,
+                                int chunksPerThread = 8);
+
+private:
+    // One kernel run with its full history, for the tape and the proxy.
+    template <class F>
+    static RootResult solve(RootMethod method, const F &f, pair<double, double> &bracket, double tol,
+                            int maxIterations);
 };
 
 #endif // ROOTMETHODS_H
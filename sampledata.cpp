@@ -0,0 +1,142 @@
+#include "sampledata.h"
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const string &path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        Error = "cannot open " + path + ": " + strerror(errno);
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        Error = "cannot stat " + path + ": " + strerror(errno);
+        ::close(fd);
+        return;
+    }
+
+    Size = static_cast<size_t>(st.st_size);
+    if (Size > 0) {
+        void *p = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            Error = "cannot map " + path + ": " + strerror(errno);
+            Size = 0;
+            ::close(fd);
+            return;
+        }
+        // One front-to-back pass: read ahead aggressively, drop behind.
+        madvise(p, Size, MADV_SEQUENTIAL);
+        Data = static_cast<const char *>(p);
+    }
+    // The mapping keeps the file referenced on its own.
+    ::close(fd);
+    Open = true;
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : Data(other.Data), Size(other.Size), Open(other.Open), Error(move(other.Error))
+{
+    other.Data = nullptr;
+    other.Size = 0;
+    other.Open = false;
+}
+
+MappedFile::~MappedFile()
+{
+    if (Data)
+        munmap(const_cast<char *>(Data), Size);
+}
+
+SampleView binarySamples(const MappedFile &file)
+{
+    SampleView view;
+    if (!file.isOpen() || file.size() == 0)
+        return view;
+    if (file.size() % (2 * sizeof(double)) != 0) {
+        cerr << "Binary sample file is not a whole number of (x, y) float64 pairs.\n";
+        return view;
+    }
+    // mmap returns page-aligned memory, so the doubles are aligned.
+    const double *pairs = reinterpret_cast<const double *>(file.data());
+    view.X = pairs;
+    view.Y = pairs + 1;
+    view.Size = file.size() / (2 * sizeof(double));
+    view.Stride = 2;
+    return view;
+}
+
+static bool isSeparator(char c)
+{
+    return c == ',' || c == ';' || c == '\t' || c == ' ' || c == '\r';
+}
+
+size_t readCsvSamples(const MappedFile &file, const std::function<void(double, double)> &sample,
+                      int xColumn, int yColumn)
+{
+    const char *p = file.data(), *end = p + file.size();
+    size_t count = 0;
+
+    while (p < end) {
+        const char *lineEnd = static_cast<const char *>(memchr(p, '\n', end - p));
+        if (!lineEnd)
+            lineEnd = end;
+
+        double x = 0, y = 0;
+        bool haveX = false, haveY = false, numeric = true;
+        const char *q = p;
+        while (q < lineEnd && (*q == ' ' || *q == '\r'))
+            ++q;
+        if (q < lineEnd && *q != '#') {
+            // Walk the fields, converting only the two we need. from_chars
+            // stops at lineEnd, so the unterminated mapping is never overrun.
+            for (int column = 0; q < lineEnd && numeric && !(haveX && haveY); ++column) {
+                const char *fieldEnd = q;
+                while (fieldEnd < lineEnd && !isSeparator(*fieldEnd))
+                    ++fieldEnd;
+
+                if (column == xColumn || column == yColumn) {
+                    const char *start = q + (q < fieldEnd && *q == '+');
+                    double v = 0;
+                    const from_chars_result r = from_chars(start, fieldEnd, v);
+                    if (r.ec != errc() || r.ptr != fieldEnd) {
+                        numeric = false;
+                    } else {
+                        if (column == xColumn) {
+                            x = v;
+                            haveX = true;
+                        }
+                        if (column == yColumn) {
+                            y = v;
+                            haveY = true;
+                        }
+                    }
+                }
+
+                // Spaces around one comma, semicolon or tab, or a run of
+                // spaces alone, separate two fields.
+                q = fieldEnd;
+                while (q < lineEnd && (*q == ' ' || *q == '\r'))
+                    ++q;
+                if (q < lineEnd && (*q == ',' || *q == ';' || *q == '\t'))
+                    ++q;
+                while (q < lineEnd && (*q == ' ' || *q == '\r'))
+                    ++q;
+            }
+            if (numeric && haveX && haveY) {
+                sample(x, y);
+                ++count;
+            }
+        }
+        p = lineEnd + 1;
+    }
+    return count;
+}
@@ -0,0 +1,82 @@
+#ifndef SAMPLEDATA_H
+#define SAMPLEDATA_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+using namespace std;
+
+/**
+ * Read-only memory map of a whole file.
+ *
+ * The pages are loaded by the kernel as they are touched and dropped under
+ * memory pressure, so files larger than RAM can be scanned once from front
+ * to back without copying them into vectors.
+ */
+class MappedFile
+{
+public:
+    /** Maps `path`; on failure isOpen() is false and error() says why. */
+    explicit MappedFile(const string &path);
+    ~MappedFile();
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile &operator=(MappedFile &&) = delete;
+
+    bool isOpen() const { return Open; }
+    const string &error() const { return Error; }
+
+    const char *data() const { return Data; }
+    size_t size() const { return Size; }
+
+private:
+    const char *Data = nullptr; // null for an empty file
+    size_t Size = 0;
+    bool Open = false;
+    string Error;
+};
+
+/**
+ * x/y samples viewed in place: sample i is (X[i * Stride], Y[i * Stride]).
+ * Plain arrays have Stride 1; interleaved (x, y) pairs have Stride 2.
+ */
+struct SampleView
+{
+    const double *X = nullptr;
+    const double *Y = nullptr;
+    size_t Size = 0;
+    size_t Stride = 1;
+
+    double x(size_t i) const { return X[i * Stride]; }
+    double y(size_t i) const { return Y[i * Stride]; }
+};
+
+/** Layout of a sample file. */
+enum class SampleFormat
+{
+    Csv,    // text, one sample per line; see readCsvSamples()
+    Binary  // native-endian float64 pairs x0 y0 x1 y1 ...
+};
+
+/**
+ * The samples of a Binary file, pointing into the mapping (no copy).
+ * Size is 0, with a message on cerr, when the file is not whole pairs.
+ */
+SampleView binarySamples(const MappedFile &file);
+
+/**
+ * Parse a CSV mapping line by line and call sample(x, y) for each row.
+ * Fields may be separated by commas, semicolons, tabs or spaces. Blank
+ * lines, lines starting with '#' and rows whose two columns are not both
+ * numbers (such as a header) are skipped.
+ *
+ * @param xColumn, yColumn  Zero-based field indices
+ * @return                  Number of samples passed to `sample`
+ */
+size_t readCsvSamples(const MappedFile &file, const std::function<void(double, double)> &sample,
+                      int xColumn = 0, int yColumn = 1);
+
+#endif // SAMPLEDATA_H
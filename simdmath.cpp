@@ -0,0 +1,297 @@
+#include "simdmath.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Built with -O3 -fno-math-errno (sqrt vectorizes), -fno-trapping-math (the
+// clamps become blends instead of branches, which AVX2 needs) and
+// -ffp-contract=off (the Dekker products below rely on every rounding step);
+// see CMakeLists.txt.
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_DISPATCH __attribute__((target_clones("avx512f", "avx2", "default")))
+#define SIMD_INLINE inline __attribute__((always_inline))
+#else
+#define SIMD_DISPATCH
+#define SIMD_INLINE inline
+#endif
+
+static const size_t Chunk = 64; // inputs are copied so in-place calls can still be patched
+
+static const double Shifter = 0x1.8p52; // x + Shifter - Shifter rounds to an integer
+static const double Ln2Hi = 6.93147180369123816490e-01;   // 32 trailing zero bits
+static const double Ln2Lo = 1.90821492927058770002e-10;
+static const double Log2e = 1.44269504088896338700e+00;
+static const double TwoOverPi = 6.36619772367581382433e-01;
+static const double Pio2_1 = 1.57079632673412561417e+00;  // first 33 bits of pi/2
+static const double Pio2_2 = 6.07710050630396597660e-11;  // next 33 bits
+static const double Pio2_3 = 2.02226624871116645580e-21;  // next 33 bits
+static const double TrigLimit = 1e5;                      // |k| < 2^20 keeps k*Pio2_i exact
+
+static SIMD_INLINE uint64_t asBits(double x)
+{
+    uint64_t b;
+    memcpy(&b, &x, sizeof b);
+    return b;
+}
+
+static SIMD_INLINE double fromBits(uint64_t b)
+{
+    double x;
+    memcpy(&x, &b, sizeof x);
+    return x;
+}
+
+// Exact product a*b = p + e (Dekker; needs |a|,|b| < 2^996).
+static SIMD_INLINE double twoProd(double a, double b, double &e)
+{
+    const double Split = 134217729.0; // 2^27 + 1
+    double ca = Split * a, cb = Split * b;
+    double ah = ca - (ca - a), al = a - ah;
+    double bh = cb - (cb - b), bl = b - bh;
+    double p = a * b;
+    e = ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+    return p;
+}
+
+// exp(hi + lo) for hi in [-708, 709], |lo| << ulp(hi).
+static SIMD_INLINE double expKernel(double hi, double lo)
+{
+    double kd = hi * Log2e + Shifter;
+    double k = kd - Shifter;
+    double r = (hi - k * Ln2Hi) - k * Ln2Lo + lo; // |r| <= ln2/2
+
+    double p = 1.0 / 6227020800.0;                // 1/13!
+    p = 1.0 / 479001600.0 + r * p;
+    p = 1.0 / 39916800.0 + r * p;
+    p = 1.0 / 3628800.0 + r * p;
+    p = 1.0 / 362880.0 + r * p;
+    p = 1.0 / 40320.0 + r * p;
+    p = 1.0 / 5040.0 + r * p;
+    p = 1.0 / 720.0 + r * p;
+    p = 1.0 / 120.0 + r * p;
+    p = 1.0 / 24.0 + r * p;
+    p = 1.0 / 6.0 + r * p;
+    p = 0.5 + r * p;
+    p = 1.0 + (r + r * r * p);
+
+    // k is in [-1021, 1023]: a single normal power of two.
+    uint64_t ki = asBits(kd) - asBits(Shifter);
+    return p * fromBits((ki + 1023) << 52);
+}
+
+// log(x) = hi + lo for normal, positive, finite x.
+static SIMD_INLINE double logKernel(double x, double &lo)
+{
+    // x = m * 2^e with m in [sqrt(2)/2, sqrt(2)), using integer ops only so
+    // the loop stays free of selects.
+    const uint64_t Off = 0x3fe6a09e667f3bcdull; // bits of sqrt(2)/2
+    uint64_t t0 = asBits(x) - Off;
+    double e = fromBits(((t0 + 0x3ff0000000000000ull) >> 52) | 0x4330000000000000ull) - 0x1p52 - 1023.0;
+    double m = fromBits((t0 & 0x000fffffffffffffull) + Off);
+
+    double f = m - 1.0;            // exact, |f| < 0.415
+    double u = 2.0 + f;
+    double uErr = (2.0 - u) + f;
+    double s = f / u;
+    double sq;
+    double sProd = twoProd(s, u, sq);
+    double sLo = ((f - sProd) - sq - s * uErr) / u; // s + sLo = f / (2 + f)
+    double z = s * s;
+    double R = 2.0 / 23.0;
+    R = 2.0 / 21.0 + z * R;
+    R = 2.0 / 19.0 + z * R;
+    R = 2.0 / 17.0 + z * R;
+    R = 2.0 / 15.0 + z * R;
+    R = 2.0 / 13.0 + z * R;
+    R = 2.0 / 11.0 + z * R;
+    R = 2.0 / 9.0 + z * R;
+    R = 2.0 / 7.0 + z * R;
+    R = 2.0 / 5.0 + z * R;
+    R = 2.0 / 3.0 + z * R;
+    R = z * R;
+
+    // log(1+f) = f - hfsq + s*hfsq + s*R, with the large terms kept exact.
+    double hfsqErr;
+    double hfsq = twoProd(0.5 * f, f, hfsqErr);
+    double t = f - hfsq;
+    double tErr = (f - t) - hfsq;
+    double shErr;
+    double sh = twoProd(s, hfsq, shErr);
+    double t2 = t + sh;
+    double t2Err = (t - t2) + sh;
+
+    // d/ds [s*(hfsq + R(s))] ~ hfsq + 3R, so sLo shifts the sum by sLo*(hfsq + 3R).
+    double corr = s * R + sLo * (hfsq + 3.0 * R) + shErr - hfsqErr + tErr + t2Err + e * Ln2Lo;
+
+    double eh = e * Ln2Hi;         // exact
+    double sum = eh + t2;
+    double bb = sum - eh;
+    double sumErr = (eh - (sum - bb)) + (t2 - bb);
+    double tail = sumErr + corr;
+    double hi = sum + tail;
+    lo = (sum - hi) + tail;
+    return hi;
+}
+
+// sin(x) for |x| <= TrigLimit; `shift` = 1 gives cos(x).
+static SIMD_INLINE double sinKernel(double x, uint64_t shift)
+{
+    double kd = x * TwoOverPi + Shifter;
+    double k = kd - Shifter;
+    uint64_t q = asBits(kd) + shift;
+
+    // r = x - k*pi/2 as rhi + rlo; the k*Pio2_i products are exact.
+    double r1 = x - k * Pio2_1;
+    double w2 = k * Pio2_2, w3 = k * Pio2_3;
+    double t = r1 - w2;
+    double tErr = (r1 - t) - w2;
+    double r = t - w3;
+    double rlo = ((t - r) - w3) + tErr;            // |r| <= pi/4
+
+    double zErr;
+    double z = twoProd(r, r, zErr);
+
+    double sp = 1.0 / 355687428096000.0;                      // 1/17!
+    sp = -1.0 / 1307674368000.0 + z * sp;
+    sp = 1.0 / 6227020800.0 + z * sp;
+    sp = -1.0 / 39916800.0 + z * sp;
+    sp = 1.0 / 362880.0 + z * sp;
+    sp = -1.0 / 5040.0 + z * sp;
+    sp = 1.0 / 120.0 + z * sp;
+    sp = -1.0 / 6.0 + z * sp;
+    double hz = 0.5 * z;
+    double sinr = r + (r * z * sp + rlo * (1.0 - hz));
+
+    double cp = 1.0 / 6402373705728000.0;                     // 1/18!
+    cp = -1.0 / 20922789888000.0 + z * cp;
+    cp = 1.0 / 87178291200.0 + z * cp;
+    cp = -1.0 / 479001600.0 + z * cp;
+    cp = 1.0 / 3628800.0 + z * cp;
+    cp = -1.0 / 40320.0 + z * cp;
+    cp = 1.0 / 720.0 + z * cp;
+    cp = -1.0 / 24.0 + z * cp;
+    double w = 1.0 - hz;
+    double cosr = w + ((((1.0 - w) - hz) - 0.5 * zErr) - (z * z * cp + r * rlo));
+
+    // Odd quadrants take cos(r), quadrants 2 and 3 flip the sign.
+    uint64_t pick = 0 - (q & 1);
+    uint64_t v = (asBits(cosr) & pick) | (asBits(sinr) & ~pick);
+    return fromBits(v ^ ((q & 2) << 62));
+}
+
+SIMD_DISPATCH void simdExp(const double *x, double *y, size_t n)
+{
+    double in[Chunk];
+    for (size_t i0 = 0; i0 < n; i0 += Chunk) {
+        const size_t m = std::min(Chunk, n - i0);
+        std::copy(x + i0, x + i0 + m, in);
+        for (size_t i = 0; i < m; ++i) {
+            double v = std::min(std::max(in[i], -708.0), 709.0);
+            y[i0 + i] = expKernel(v, 0.0);
+        }
+        for (size_t i = 0; i < m; ++i) {
+            if (!(in[i] >= -708.0 && in[i] <= 709.0))
+                y[i0 + i] = std::exp(in[i]);
+        }
+    }
+}
+
+SIMD_DISPATCH void simdLog(const double *x, double *y, size_t n)
+{
+    double in[Chunk];
+    for (size_t i0 = 0; i0 < n; i0 += Chunk) {
+        const size_t m = std::min(Chunk, n - i0);
+        std::copy(x + i0, x + i0 + m, in);
+        for (size_t i = 0; i < m; ++i) {
+            double lo;
+            double hi = logKernel(in[i], lo);
+            y[i0 + i] = hi + lo;
+        }
+        for (size_t i = 0; i < m; ++i) {
+            if (!(in[i] >= DBL_MIN && in[i] <= DBL_MAX))
+                y[i0 + i] = std::log(in[i]);
+        }
+    }
+}
+
+SIMD_DISPATCH void simdSin(const double *x, double *y, size_t n)
+{
+    double in[Chunk];
+    for (size_t i0 = 0; i0 < n; i0 += Chunk) {
+        const size_t m = std::min(Chunk, n - i0);
+        std::copy(x + i0, x + i0 + m, in);
+        for (size_t i = 0; i < m; ++i) {
+            double v = std::min(std::max(in[i], -TrigLimit), TrigLimit);
+            y[i0 + i] = sinKernel(v, 0);
+        }
+        for (size_t i = 0; i < m; ++i) {
+            if (!(std::fabs(in[i]) <= TrigLimit))
+                y[i0 + i] = std::sin(in[i]);
+        }
+    }
+}
+
+SIMD_DISPATCH void simdCos(const double *x, double *y, size_t n)
+{
+    double in[Chunk];
+    for (size_t i0 = 0; i0 < n; i0 += Chunk) {
+        const size_t m = std::min(Chunk, n - i0);
+        std::copy(x + i0, x + i0 + m, in);
+        for (size_t i = 0; i < m; ++i) {
+            double v = std::min(std::max(in[i], -TrigLimit), TrigLimit);
+            y[i0 + i] = sinKernel(v, 1);
+        }
+        for (size_t i = 0; i < m; ++i) {
+            if (!(std::fabs(in[i]) <= TrigLimit))
+                y[i0 + i] = std::cos(in[i]);
+        }
+    }
+}
+
+SIMD_DISPATCH void simdSqrt(const double *x, double *y, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        y[i] = std::sqrt(x[i]);
+}
+
+SIMD_DISPATCH void simdPow(const double *x, const double *p, double *y, size_t n)
+{
+    double in[Chunk], ex[Chunk], arg[Chunk];
+    for (size_t i0 = 0; i0 < n; i0 += Chunk) {
+        const size_t m = std::min(Chunk, n - i0);
+        std::copy(x + i0, x + i0 + m, in);
+        std::copy(p + i0, p + i0 + m, ex);
+        for (size_t i = 0; i < m; ++i) {
+            double b = std::min(std::max(in[i], DBL_MIN), DBL_MAX);
+            double e = std::min(std::max(ex[i], -1e300), 1e300);
+            double lo;
+            double l = logKernel(b, lo);
+            double plo;
+            double phi = twoProd(e, l, plo);
+            plo += e * lo;
+            arg[i] = phi;
+            double v = std::min(std::max(phi, -708.0), 709.0);
+            y[i0 + i] = expKernel(v, plo);
+        }
+        for (size_t i = 0; i < m; ++i) {
+            if (!(in[i] >= DBL_MIN && in[i] <= DBL_MAX && std::fabs(ex[i]) <= 1e300
+                  && arg[i] >= -708.0 && arg[i] <= 709.0))
+                y[i0 + i] = std::pow(in[i], ex[i]);
+        }
+    }
+}
+
+const char *simdTarget()
+{
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    if (__builtin_cpu_supports("avx512f"))
+        return "avx512f";
+    if (__builtin_cpu_supports("avx2"))
+        return "avx2";
+#endif
+    return "default";
+}
@@ -0,0 +1,120 @@
+#ifndef SOBOL_H
+#define SOBOL_H
+
+#include <cstdint>
+
+/**
+ * Owen-scrambled Sobol points in [0, 1)^d, d <= SobolSequence::MaxDimensions.
+ *
+ * Direction numbers are Joe and Kuo's (new-joe-kuo-6.21201). Scrambling is
+ * the hash-based nested uniform scramble of Burley (2020): reversing the
+ * bits turns a Laine-Karras hash, where each bit depends only on the bits
+ * below it, into a permutation that depends only on the bits above, which
+ * is exactly Owen's scramble. Any 2^m consecutive aligned points keep the
+ * net property, and different seeds give independent randomizations, so the
+ * spread of estimates across seeds is an honest error estimate.
+ *
+ * Points are computed from their index alone; blocks of a sequence can be
+ * generated on different threads in any order.
+ */
+class SobolSequence
+{
+public:
+    static constexpr unsigned MaxDimensions = 8;
+
+    SobolSequence(unsigned dimensions, uint32_t seed) : Dimensions(dimensions)
+    {
+        // Degree s, coefficients a and initial m_1..m_s of the primitive
+        // polynomial of each dimension after the first.
+        static const struct { unsigned S, A; uint32_t M[5]; } Table[MaxDimensions - 1] = {
+            {1, 0, {1}},
+            {2, 1, {1, 3}},
+            {3, 1, {1, 3, 1}},
+            {3, 2, {1, 1, 1}},
+            {4, 1, {1, 1, 3, 3}},
+            {4, 4, {1, 3, 5, 13}},
+            {5, 2, {1, 1, 5, 5, 17}},
+        };
+
+        for (unsigned d = 0; d < dimensions && d < MaxDimensions; ++d) {
+            uint32_t *v = Directions[d];
+            if (d == 0) {
+                for (unsigned k = 0; k < 32; ++k)
+                    v[k] = uint32_t(1) << (31 - k);
+            } else {
+                const unsigned s = Table[d - 1].S, a = Table[d - 1].A;
+                for (unsigned k = 0; k < s; ++k)
+                    v[k] = Table[d - 1].M[k] << (31 - k);
+                for (unsigned k = s; k < 32; ++k) {
+                    v[k] = v[k - s] ^ (v[k - s] >> s);
+                    for (unsigned j = 1; j < s; ++j)
+                        if ((a >> (s - 1 - j)) & 1)
+                            v[k] ^= v[k - j];
+                }
+            }
+            Seeds[d] = hash(seed ^ hash(d + 0x9e3779b9u));
+        }
+    }
+
+    bool valid() const { return Dimensions >= 1 && Dimensions <= MaxDimensions; }
+    unsigned dimensions() const { return Dimensions; }
+
+    /** Coordinate `dim` of point `index`, as 32 scrambled bits. */
+    uint32_t bits(uint32_t index, unsigned dim) const
+    {
+        uint32_t x = 0;
+        for (unsigned k = 0; index; index >>= 1, ++k)
+            if (index & 1)
+                x ^= Directions[dim][k];
+        return owenScramble(x, Seeds[dim]);
+    }
+
+    /** Coordinate `dim` of point `index` in (0, 1): the centre of its 2^-32 cell. */
+    double point(uint32_t index, unsigned dim) const
+    {
+        return (bits(index, dim) + 0.5) * (1.0 / 4294967296.0);
+    }
+
+private:
+    static uint32_t reverseBits(uint32_t x)
+    {
+        x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+        x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+        x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+        x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+        return (x >> 16) | (x << 16);
+    }
+
+    // Each output bit depends only on the input bits below it.
+    static uint32_t laineKarras(uint32_t x, uint32_t seed)
+    {
+        x += seed;
+        x ^= x * 0x6c50b47cu;
+        x ^= x * 0xb82f1e52u;
+        x ^= x * 0xc7afe638u;
+        x ^= x * 0x8d22f6e6u;
+        return x;
+    }
+
+    static uint32_t owenScramble(uint32_t x, uint32_t seed)
+    {
+        return reverseBits(laineKarras(reverseBits(x), seed));
+    }
+
+    // Integer mixing hash (lowbias32), for per-dimension seeds.
+    static uint32_t hash(uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    unsigned Dimensions;
+    uint32_t Directions[MaxDimensions][32] = {};
+    uint32_t Seeds[MaxDimensions] = {};
+};
+
+#endif // SOBOL_H
@@ -0,0 +1,113 @@
+#include "threadpool.h"
+
+#include <exception>
+
+ThreadPool &ThreadPool::instance()
+{
+    static ThreadPool pool(thread::hardware_concurrency());
+    return pool;
+}
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if (threads == 0)
+        threads = 1;
+    for (unsigned i = 0; i < threads; ++i)
+        Queues.push_back(make_unique<Queue>());
+    // The calling thread helps in parallelFor(), so one fewer worker keeps
+    // exactly `threads` busy.
+    for (unsigned i = 1; i < threads; ++i)
+        Workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(SleepMutex);
+        Stop = true;
+    }
+    Wake.notify_all();
+    for (thread &t : Workers)
+        t.join();
+}
+
+// Pop from our own deque's back, else steal from another's front.
+bool ThreadPool::runOne(unsigned home)
+{
+    std::function<void()> task;
+    for (unsigned k = 0; k < Queues.size() && !task; ++k) {
+        Queue &q = *Queues[(home + k) % Queues.size()];
+        lock_guard<mutex> lock(q.Mutex);
+        if (q.Tasks.empty())
+            continue;
+        if (k == 0) {
+            task = move(q.Tasks.back());
+            q.Tasks.pop_back();
+        } else {
+            task = move(q.Tasks.front());
+            q.Tasks.pop_front();
+        }
+    }
+    if (!task)
+        return false;
+
+    --Pending;
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(unsigned index)
+{
+    for (;;) {
+        if (runOne(index))
+            continue;
+        unique_lock<mutex> lock(SleepMutex);
+        Wake.wait(lock, [this] { return Stop || Pending > 0; });
+        if (Stop)
+            return;
+    }
+}
+
+void ThreadPool::parallelFor(size_t n, const std::function<void(size_t)> &body)
+{
+    if (n == 0)
+        return;
+    if (n == 1 || Queues.size() == 1) {
+        for (size_t i = 0; i < n; ++i)
+            body(i);
+        return;
+    }
+
+    atomic<size_t> remaining(n);
+    mutex errorMutex;
+    exception_ptr error;
+
+    // Deal the indices round-robin; stealing evens out the rest.
+    for (size_t i = 0; i < n; ++i) {
+        Queue &q = *Queues[i % Queues.size()];
+        lock_guard<mutex> lock(q.Mutex);
+        q.Tasks.push_back([&, i] {
+            try {
+                body(i);
+            } catch (...) {
+                lock_guard<mutex> errorLock(errorMutex);
+                if (!error)
+                    error = current_exception();
+            }
+            --remaining;
+        });
+        ++Pending;
+    }
+    {
+        lock_guard<mutex> lock(SleepMutex);
+    }
+    Wake.notify_all();
+
+    while (remaining > 0) {
+        if (!runOne(0))
+            this_thread::yield();
+    }
+
+    if (error)
+        rethrow_exception(error);
+}
@@ -0,0 +1,64 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Work-stealing thread pool shared by the parallel solvers.
+ *
+ * Each worker owns a deque: it pops its own tasks from the back and, when
+ * empty, steals from the front of the others, so uneven work (a chunk with
+ * many roots next to a chunk with none) is rebalanced without a central
+ * queue. A thread waiting in parallelFor() runs tasks too, which makes
+ * nested parallel loops safe.
+ */
+class ThreadPool
+{
+public:
+    /** Process-wide pool with one worker per hardware thread. */
+    static ThreadPool &instance();
+
+    explicit ThreadPool(unsigned threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /** Number of workers (at least 1). */
+    unsigned size() const { return static_cast<unsigned>(Queues.size()); }
+
+    /**
+     * Run body(i) for every i in [0, n) and return when all are done.
+     * The first exception thrown by body is rethrown here.
+     */
+    void parallelFor(size_t n, const std::function<void(size_t)> &body);
+
+private:
+    struct Queue
+    {
+        mutex Mutex;
+        deque<std::function<void()>> Tasks;
+    };
+
+    void workerLoop(unsigned index);
+    bool runOne(unsigned home);
+
+    vector<unique_ptr<Queue>> Queues;
+    vector<thread> Workers;
+
+    mutex SleepMutex;
+    condition_variable Wake;
+    atomic<size_t> Pending{0};
+    bool Stop = false;
+};
+
+#endif // THREADPOOL_H